@@ -0,0 +1,28 @@
+#pragma once
+
+#include <atomic>
+
+/* Set once to ask a worker to stop. Waits that take a token return early once it is set,
+ * whoever cancels also wakes the waits it knows about (see CSignal::Notify() and CFrameClock::Wake()). */
+class CCancellation
+{
+public:
+	void Cancel()
+	{
+		Cancelled.store(true, std::memory_order_release);
+	}
+
+	/* Only while no worker uses the token, e.g. before starting a new one. */
+	void Reset()
+	{
+		Cancelled.store(false, std::memory_order_release);
+	}
+
+	bool IsCancelled() const
+	{
+		return Cancelled.load(std::memory_order_acquire);
+	}
+
+private:
+	std::atomic<bool> Cancelled{ false };
+};
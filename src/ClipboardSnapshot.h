@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+/* Every format of one clipboard content, copied byte for byte into a single pooled buffer.
+ * The buffer keeps its capacity between snapshots, so after the first large clipboard saving does not allocate anymore. */
+class CClipboardSnapshot
+{
+public:
+	struct Entry
+	{
+		unsigned	Format;
+		size_t		Offset;
+		size_t		Size;
+	};
+
+	void Clear()
+	{
+		Entries.clear();
+		Used = 0;
+	}
+
+	/* Makes room for aSize bytes of aFormat and returns where to copy them. Valid until the next Reserve() or Clear(). */
+	unsigned char* Reserve(unsigned aFormat, size_t aSize)
+	{
+		if (Used + aSize > Capacity)
+		{
+			/* grow without zeroing, only the used part is carried over */
+			size_t capacity = Capacity * 2 > Used + aSize ? Capacity * 2 : Used + aSize;
+			std::unique_ptr<unsigned char[]> pool(new unsigned char[capacity]);
+			if (Used > 0)
+			{
+				memcpy(pool.get(), Pool.get(), Used);
+			}
+			Pool = std::move(pool);
+			Capacity = capacity;
+		}
+
+		Entries.push_back(Entry{ aFormat, Used, aSize });
+		Used += aSize;
+		return Pool.get() + Entries.back().Offset;
+	}
+
+	const std::vector<Entry>& Formats() const
+	{
+		return Entries;
+	}
+
+	const unsigned char* Data(const Entry& aEntry) const
+	{
+		return Pool.get() + aEntry.Offset;
+	}
+
+	bool IsEmpty() const
+	{
+		return Entries.empty();
+	}
+
+	/* bytes held by the current snapshot */
+	size_t Size() const
+	{
+		return Used;
+	}
+
+private:
+	std::unique_ptr<unsigned char[]>	Pool;
+	size_t								Capacity = 0;
+	size_t								Used = 0;
+	std::vector<Entry>					Entries;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/* Runs a write callback on a background thread once no new request came in for QuietPeriod.
+ * Rapid Schedule() calls collapse into a single write, the caller never touches the disk. */
+class CDeferredWriter
+{
+public:
+	CDeferredWriter(std::chrono::milliseconds aQuietPeriod)
+		: QuietPeriod(aQuietPeriod)
+	{
+	}
+
+	void Start(std::function<void()> aWrite)
+	{
+		Write = std::move(aWrite);
+		IsRunning = true;
+		Thread = std::thread(&CDeferredWriter::Run, this);
+	}
+
+	/* Writes anything still pending and joins the thread. */
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			if (!IsRunning) { return; }
+			IsRunning = false;
+		}
+		Condition.notify_one();
+
+		if (Thread.joinable())
+		{
+			Thread.join();
+		}
+	}
+
+	void Schedule()
+	{
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			IsPending = true;
+			Deadline = std::chrono::steady_clock::now() + QuietPeriod;
+		}
+		Condition.notify_one();
+	}
+
+private:
+	void Run()
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		for (;;)
+		{
+			Condition.wait(lock, [this] { return IsPending || !IsRunning; });
+
+			/* every Schedule() pushes the deadline back, Stop() skips the rest of the wait */
+			while (IsRunning && std::chrono::steady_clock::now() < Deadline)
+			{
+				std::chrono::steady_clock::time_point deadline = Deadline;
+				Condition.wait_until(lock, deadline);
+			}
+
+			if (IsPending)
+			{
+				IsPending = false;
+				lock.unlock();
+				Write();
+				lock.lock();
+			}
+
+			if (!IsRunning)
+			{
+				break;
+			}
+		}
+	}
+
+	const std::chrono::milliseconds			QuietPeriod;
+	std::function<void()>					Write;
+
+	std::mutex								Mutex;
+	std::condition_variable					Condition;
+	std::thread								Thread;
+	bool									IsRunning = false;
+	bool									IsPending = false;
+	std::chrono::steady_clock::time_point	Deadline{};
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include "Cancellation.h"
+
+/* Lets a worker sleep until the game publishes its next frame instead of polling on a fixed interval.
+ * The producer calls Publish() once per frame with the MumbleLink tick, it only takes the lock if somebody is waiting. */
+class CFrameClock
+{
+public:
+	void Publish(unsigned aTick)
+	{
+		if (Tick.load(std::memory_order_relaxed) == aTick)
+		{
+			return;
+		}
+
+		Tick.store(aTick);
+
+		if (Waiters.load() > 0)
+		{
+			{
+				std::lock_guard<std::mutex> lock(Mutex);
+			}
+			Condition.notify_all();
+		}
+	}
+
+	unsigned Current() const
+	{
+		return Tick.load();
+	}
+
+	/* Blocks until a tick other than aTick is published. Updates aTick, returns false if the deadline passed or aCancel was set first. */
+	bool WaitNext(unsigned& aTick, std::chrono::steady_clock::time_point aDeadline, const CCancellation* aCancel = nullptr)
+	{
+		Waiters.fetch_add(1);
+
+		bool published;
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+			published = Condition.wait_until(lock, aDeadline, [this, aTick, aCancel] { return Tick.load() != aTick || (aCancel && aCancel->IsCancelled()); });
+		}
+
+		Waiters.fetch_sub(1);
+
+		aTick = Tick.load();
+		return published && !(aCancel && aCancel->IsCancelled());
+	}
+
+	/* Wakes every waiter so it can look at its cancellation token. */
+	void Wake()
+	{
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+		}
+		Condition.notify_all();
+	}
+
+private:
+	std::mutex				Mutex;
+	std::condition_variable	Condition;
+	std::atomic<unsigned>	Tick{ 0 };
+	std::atomic<int>		Waiters{ 0 };
+};
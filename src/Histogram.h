@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+
+/* Lock-free log-linear histogram: every power of two is split into four buckets, which keeps the error under 25%.
+ * Recording is one relaxed atomic increment, so it is cheap enough to leave on in production. */
+class CHistogram
+{
+public:
+	static constexpr unsigned SUB_BUCKETS = 4;
+	static constexpr unsigned BUCKETS = 64 * SUB_BUCKETS;
+
+	void Record(unsigned long long aValue)
+	{
+		Counts[BucketOf(aValue)].fetch_add(1, std::memory_order_relaxed);
+		Total.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	unsigned long long Count() const
+	{
+		return Total.load(std::memory_order_relaxed);
+	}
+
+	/* Returns the upper bound of the bucket that holds the given percentile (0.0 - 1.0), 0 if nothing was recorded. */
+	unsigned long long Percentile(double aPercentile) const
+	{
+		unsigned long long total = 0;
+		unsigned long long counts[BUCKETS];
+		for (unsigned i = 0; i < BUCKETS; i++)
+		{
+			counts[i] = Counts[i].load(std::memory_order_relaxed);
+			total += counts[i];
+		}
+
+		if (total == 0)
+		{
+			return 0;
+		}
+
+		unsigned long long target = static_cast<unsigned long long>(aPercentile * total + 0.5);
+		if (target < 1) { target = 1; }
+
+		unsigned long long seen = 0;
+		for (unsigned i = 0; i < BUCKETS; i++)
+		{
+			seen += counts[i];
+			if (seen >= target)
+			{
+				return UpperBound(i);
+			}
+		}
+
+		return UpperBound(BUCKETS - 1);
+	}
+
+	void Reset()
+	{
+		for (unsigned i = 0; i < BUCKETS; i++)
+		{
+			Counts[i].store(0, std::memory_order_relaxed);
+		}
+		Total.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	static unsigned BucketOf(unsigned long long aValue)
+	{
+		if (aValue < SUB_BUCKETS)
+		{
+			return static_cast<unsigned>(aValue);
+		}
+
+		/* index of the highest set bit, binary search instead of a compiler intrinsic to stay portable */
+		unsigned msb = 0;
+		unsigned long long v = aValue;
+		if (v >> 32) { v >>= 32; msb += 32; }
+		if (v >> 16) { v >>= 16; msb += 16; }
+		if (v >> 8) { v >>= 8; msb += 8; }
+		if (v >> 4) { v >>= 4; msb += 4; }
+		if (v >> 2) { v >>= 2; msb += 2; }
+		if (v >> 1) { msb += 1; }
+
+		unsigned sub = static_cast<unsigned>(aValue >> (msb - 2)) & (SUB_BUCKETS - 1);
+		return (msb - 1) * SUB_BUCKETS + sub;
+	}
+
+	static unsigned long long UpperBound(unsigned aBucket)
+	{
+		if (aBucket < SUB_BUCKETS)
+		{
+			return aBucket;
+		}
+
+		unsigned msb = aBucket / SUB_BUCKETS + 1;
+		unsigned long long sub = aBucket % SUB_BUCKETS;
+		unsigned long long lower = (SUB_BUCKETS + sub) << (msb - 2);
+		return lower + (1ull << (msb - 2)) - 1;
+	}
+
+	std::atomic<unsigned long long>	Counts[BUCKETS]{};
+	std::atomic<unsigned long long>	Total{ 0 };
+};
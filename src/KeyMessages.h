@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+/* The lParam of WM_KEYDOWN, WM_KEYUP, WM_CHAR and their WM_SYS* variants ("keystroke message flags"):
+ * bits 0-15 repeat count, 16-23 scan code, 24 extended key, 29 context code (alt held), 30 previous key state, 31 transition state. */
+struct KeystrokeFlags
+{
+	unsigned short	RepeatCount;
+	unsigned short	ScanCode;			/* 0xE0xx for extended keys, like GetScancodeName() takes them */
+	bool			ContextCode;
+	bool			PreviousKeyState;	/* the key was down before this message */
+	bool			TransitionState;	/* the key is being released */
+};
+
+constexpr uint32_t EncodeKeystroke(const KeystrokeFlags& aFlags)
+{
+	return static_cast<uint32_t>(aFlags.RepeatCount)
+		| (static_cast<uint32_t>(aFlags.ScanCode & 0xFF) << 16)
+		| ((aFlags.ScanCode & 0xE000) ? 1u << 24 : 0u)
+		| (aFlags.ContextCode ? 1u << 29 : 0u)
+		| (aFlags.PreviousKeyState ? 1u << 30 : 0u)
+		| (aFlags.TransitionState ? 1u << 31 : 0u);
+}
+
+constexpr KeystrokeFlags DecodeKeystroke(uint32_t aLParam)
+{
+	return KeystrokeFlags{
+		static_cast<unsigned short>(aLParam & 0xFFFF),
+		static_cast<unsigned short>(((aLParam >> 16) & 0xFF) | ((aLParam & (1u << 24)) ? 0xE000 : 0)),
+		(aLParam & (1u << 29)) != 0,
+		(aLParam & (1u << 30)) != 0,
+		(aLParam & (1u << 31)) != 0
+	};
+}
+
+/* A single press as the game would receive it from the keyboard: repeat count 1, the key was up before. */
+constexpr uint32_t KeyDownLParam(unsigned short aScanCode)
+{
+	return EncodeKeystroke(KeystrokeFlags{ 1, aScanCode, false, false, false });
+}
+
+/* The matching release, previous key state and transition state are always set. */
+constexpr uint32_t KeyUpLParam(unsigned short aScanCode)
+{
+	return EncodeKeystroke(KeystrokeFlags{ 1, aScanCode, false, true, true });
+}
+
+static_assert(KeyDownLParam(0x1C) == 0x001C0001, "Return press");
+static_assert(KeyUpLParam(0x1C) == 0xC01C0001, "Return release");
+static_assert(KeyDownLParam(0xE01D) == 0x011D0001, "Right control press");
+static_assert(EncodeKeystroke(KeystrokeFlags{ 1, 0x38, true, false, false }) == 0x20380001, "Alt press");
+static_assert(DecodeKeystroke(KeyUpLParam(0xE01D)).ScanCode == 0xE01D, "Extended scan codes survive a round trip");
+static_assert(DecodeKeystroke(0xC01C0001).TransitionState && DecodeKeystroke(0xC01C0001).PreviousKeyState, "Release flags decode");
+static_assert(EncodeKeystroke(DecodeKeystroke(0xE13F0005)) == 0xE13F0005, "Every defined bit survives a round trip");
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Names of all 512 scancodes of one keyboard layout, 256 plain ones followed by 256 with the extended flag.
+ * The names are packed back to back into a single arena and indexed by offset. */
+template<typename TLayout>
+struct ScancodeNameTable
+{
+	TLayout				Layout;
+	unsigned short		Offsets[512];
+	std::vector<char>	Arena;
+
+	static unsigned Index(unsigned short aScanCode)
+	{
+		return (aScanCode & 0xFF) | ((aScanCode & 0xE000) ? 0x100 : 0);
+	}
+
+	const char* Get(unsigned short aScanCode) const
+	{
+		return &Arena[Offsets[Index(aScanCode)]];
+	}
+};
+
+/* Scan code names per keyboard layout, each table built the first time its layout is asked for.
+ * Lookups for a known layout are a few atomic loads and never allocate. Returned names stay valid until Clear().
+ * Once all Slots are taken, further layouts are looked up uncached, their names only stay valid until the next lookup on the same thread. */
+template<typename TLayout, size_t Slots = 8>
+class CScancodeNames
+{
+public:
+	using Table = ScancodeNameTable<TLayout>;
+
+	~CScancodeNames()
+	{
+		Clear();
+	}
+
+	/* aNameOf(aScanCode, aBuffer, aSize) writes the name like GetKeyNameTextA and returns its length, it is only called to build a table. */
+	template<typename TNameOf>
+	const char* Get(TLayout aLayout, unsigned short aScanCode, TNameOf aNameOf)
+	{
+		for (std::atomic<Table*>& slot : Tables)
+		{
+			Table* table = slot.load(std::memory_order_acquire);
+			if (!table) { break; }
+			if (table->Layout == aLayout) { return table->Get(aScanCode); }
+		}
+
+		/* first lookup with this layout */
+		std::lock_guard<std::mutex> lock(Mutex);
+		for (std::atomic<Table*>& slot : Tables)
+		{
+			Table* table = slot.load(std::memory_order_acquire);
+			if (!table)
+			{
+				table = Build(aLayout, aNameOf);
+				slot.store(table, std::memory_order_release);
+				return table->Get(aScanCode);
+			}
+			if (table->Layout == aLayout) { return table->Get(aScanCode); }
+		}
+
+		/* more layouts than slots, a table in use cannot be freed to make room */
+		thread_local char buff[64];
+		int len = aNameOf(aScanCode, buff, static_cast<int>(sizeof(buff)));
+		if (len < 0) { len = 0; }
+		if (len >= static_cast<int>(sizeof(buff))) { len = static_cast<int>(sizeof(buff)) - 1; }
+		buff[len] = '\0';
+		Uncached.fetch_add(1, std::memory_order_relaxed);
+		return buff;
+	}
+
+	/* Only once nobody can hold a returned name any more, e.g. on unload. */
+	void Clear()
+	{
+		for (std::atomic<Table*>& slot : Tables)
+		{
+			delete slot.exchange(nullptr);
+		}
+	}
+
+	std::atomic<unsigned long long>	Builds{ 0 };
+	std::atomic<unsigned long long>	Uncached{ 0 };
+
+private:
+	template<typename TNameOf>
+	Table* Build(TLayout aLayout, TNameOf& aNameOf)
+	{
+		Table* table = new Table();
+		table->Layout = aLayout;
+		table->Arena.reserve(512 * 8);
+
+		char buff[64];
+		for (unsigned i = 0; i < 512; i++)
+		{
+			unsigned short scanCode = static_cast<unsigned short>((i & 0xFF) | (i >= 256 ? 0xE000 : 0));
+
+			int len = aNameOf(scanCode, buff, static_cast<int>(sizeof(buff)));
+			if (len < 0) { len = 0; }
+
+			table->Offsets[i] = static_cast<unsigned short>(table->Arena.size());
+			table->Arena.insert(table->Arena.end(), buff, buff + len);
+			table->Arena.push_back('\0');
+		}
+
+		Builds.fetch_add(1, std::memory_order_relaxed);
+		return table;
+	}
+
+	std::atomic<Table*>	Tables[Slots]{};
+	std::mutex			Mutex;
+};
+
+/* Writes the UTF-8 form of a string in the active code page into aBuffer, always NUL terminated, truncated if needed.
+ * Returns the number of bytes written without the terminator. ASCII is the same in every code page and in UTF-8 and is copied as is,
+ * anything else goes through aConvert(aMultibyte, aBuffer, aSize), which returns the same. */
+template<typename TConvert>
+size_t ConvertToUTF8(const char* aMultibyte, char* aBuffer, size_t aSize, TConvert aConvert)
+{
+	if (aSize == 0) { return 0; }
+
+	size_t len = 0;
+	bool isAscii = true;
+	for (; aMultibyte[len]; len++)
+	{
+		if (aMultibyte[len] & 0x80) { isAscii = false; }
+	}
+
+	if (!isAscii)
+	{
+		return aConvert(aMultibyte, aBuffer, aSize);
+	}
+
+	if (len >= aSize) { len = aSize - 1; }
+	memcpy(aBuffer, aMultibyte, len);
+	aBuffer[len] = '\0';
+	return len;
+}
+
+/* Interned keybind strings per (keybind, padding, keyboard layout). TKeybind has Key, Alt, Ctrl and Shift.
+ * A string is formatted once, later calls only hash and look it up. The strings are never erased, so the returned pointers stay valid. */
+template<typename TKeybind, typename TLayout>
+class CKeybindStrings
+{
+public:
+	/* aFormat(aBuffer, aSize) writes the string on the first call for a key and returns its length. */
+	template<typename TFormat>
+	const char* Get(const TKeybind& aKeybind, bool aPadded, TLayout aLayout, TFormat aFormat)
+	{
+		Key key{ aKeybind.Key, aKeybind.Alt, aKeybind.Ctrl, aKeybind.Shift, aPadded, aLayout };
+
+		std::lock_guard<std::mutex> lock(Mutex);
+
+		auto it = Strings.find(key);
+		if (it != Strings.end())
+		{
+			return it->second.c_str();
+		}
+
+		char buff[512];
+		size_t len = aFormat(buff, sizeof(buff));
+		return Strings.emplace(key, std::string(buff, len)).first->second.c_str();
+	}
+
+private:
+	struct Key
+	{
+		unsigned short	Code;
+		bool			Alt;
+		bool			Ctrl;
+		bool			Shift;
+		bool			Padded;
+		TLayout			Layout;
+
+		bool operator==(const Key& rhs) const
+		{
+			return Code == rhs.Code && Alt == rhs.Alt && Ctrl == rhs.Ctrl && Shift == rhs.Shift && Padded == rhs.Padded && Layout == rhs.Layout;
+		}
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& aKey) const
+		{
+			size_t bits = static_cast<size_t>(aKey.Code) |
+				(aKey.Alt ? 1ull << 16 : 0) |
+				(aKey.Ctrl ? 1ull << 17 : 0) |
+				(aKey.Shift ? 1ull << 18 : 0) |
+				(aKey.Padded ? 1ull << 19 : 0);
+			return std::hash<size_t>()(bits) ^ std::hash<TLayout>()(aKey.Layout);
+		}
+	};
+
+	std::unordered_map<Key, std::string, KeyHash>	Strings;
+	std::mutex										Mutex;
+};
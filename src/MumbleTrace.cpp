@@ -0,0 +1,48 @@
+#include "MumbleTrace.h"
+
+bool CTraceRecorder::Start(const std::filesystem::path& aPath)
+{
+	Stop();
+
+	File.rdbuf()->pubsetbuf(Buffer, sizeof(Buffer));
+	File.open(aPath, std::ios::binary | std::ios::trunc);
+	if (!File.is_open())
+	{
+		return false;
+	}
+
+	TraceHeader header{ { 'S', 'G', 'G', 'T' }, TRACE_VERSION };
+	File.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	Origin = 0;
+	LastTick = 0;
+	Records = 0;
+	return true;
+}
+
+void CTraceRecorder::Stop()
+{
+	if (File.is_open())
+	{
+		File.close();
+	}
+}
+
+void CTraceRecorder::Record(TraceRecord aRecord)
+{
+	if (!File.is_open() || (Records > 0 && aRecord.Tick == LastTick))
+	{
+		return;
+	}
+
+	if (Records == 0)
+	{
+		Origin = aRecord.Timestamp;
+	}
+
+	LastTick = aRecord.Tick;
+	aRecord.Timestamp -= Origin;
+
+	File.write(reinterpret_cast<const char*>(&aRecord), sizeof(aRecord));
+	Records++;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+
+/* On-disk layout of a MumbleLink context trace: a TraceHeader followed by one TraceRecord per game frame.
+ * Traces are replayed against the pipeline by the tests, see tests/TraceReplay.h. */
+#pragma pack(push, 1)
+struct TraceHeader
+{
+	char		Magic[4];	/* "SGGT" */
+	uint32_t	Version;
+};
+
+struct TraceRecord
+{
+	uint32_t	Tick;		/* MumbleLink uiTick */
+	int64_t		Timestamp;	/* microseconds since the recording started */
+	uint32_t	MapID;
+	uint8_t		MapType;
+	uint8_t		Flags;		/* ETraceFlags */
+};
+#pragma pack(pop)
+
+enum ETraceFlags : uint8_t
+{
+	ETraceFlags_IsMapOpen			= 1 << 0,
+	ETraceFlags_IsGameFocused		= 1 << 1,
+	ETraceFlags_IsTextboxFocused	= 1 << 2,
+	ETraceFlags_IsInCombat			= 1 << 3,
+	ETraceFlags_IsInstance			= 1 << 4
+};
+
+constexpr uint32_t TRACE_VERSION = 1;
+
+/* Appends one record per new tick. Not thread safe, meant to be fed from the render thread only. */
+class CTraceRecorder
+{
+public:
+	bool Start(const std::filesystem::path& aPath);
+	void Stop();
+	bool IsRecording() const { return File.is_open(); }
+
+	/* aRecord.Timestamp is absolute, it is stored relative to the first record. Repeated ticks are ignored. */
+	void Record(TraceRecord aRecord);
+
+	unsigned long long Count() const { return Records; }
+
+private:
+	std::ofstream		File;
+	char				Buffer[64 * 1024];
+	int64_t				Origin = 0;
+	uint32_t			LastTick = 0;
+	unsigned long long	Records = 0;
+};
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Settings.h"
+
+/* A run of inputs sent in one go, as a slice of BasicPhraseTable::Inputs or BasicPhraseTable::Messages. */
+struct InputRun
+{
+	size_t	Offset;
+	size_t	Count;
+};
+
+/* Appends the UTF-16 form of a UTF-8 string and its terminator, one code unit per element.
+ * Malformed sequences become U+FFFD like MultiByteToWideChar(CP_UTF8) without MB_ERR_INVALID_CHARS. */
+inline void AppendUtf16(std::vector<wchar_t>& aOut, const char* aUtf8)
+{
+	const unsigned char* s = reinterpret_cast<const unsigned char*>(aUtf8);
+	while (*s)
+	{
+		unsigned lead = *s++;
+		unsigned length = lead < 0x80 ? 0 : lead < 0xC2 ? 4 : lead < 0xE0 ? 1 : lead < 0xF0 ? 2 : lead < 0xF5 ? 3 : 4;
+		if (length == 4)
+		{
+			aOut.push_back(0xFFFD);
+			continue;
+		}
+
+		unsigned codePoint = length == 0 ? lead : lead & (0x3F >> length);
+		unsigned read = 0;
+		for (; read < length && (s[read] & 0xC0) == 0x80; read++)
+		{
+			codePoint = (codePoint << 6) | (s[read] & 0x3F);
+		}
+		s += read;
+
+		/* truncated, overlong, surrogate or past U+10FFFF */
+		if (read < length
+			|| (length == 2 && codePoint < 0x800)
+			|| (length == 3 && (codePoint < 0x10000 || codePoint > 0x10FFFF))
+			|| (codePoint >= 0xD800 && codePoint <= 0xDFFF))
+		{
+			aOut.push_back(0xFFFD);
+		}
+		else if (codePoint >= 0x10000)
+		{
+			codePoint -= 0x10000;
+			aOut.push_back(static_cast<wchar_t>(0xD800 + (codePoint >> 10)));
+			aOut.push_back(static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF)));
+		}
+		else
+		{
+			aOut.push_back(static_cast<wchar_t>(codePoint));
+		}
+	}
+	aOut.push_back(L'\0');
+}
+
+/* The keys the sequences are made of, the platform maps them to its virtual key codes and scan codes. */
+enum class EKey
+{
+	Return,
+	Control,
+	V
+};
+
+/* Every phrase of one config and keyboard layout, compiled once on the worker.
+ * All input sequences live in one contiguous arena, all window messages in another and all UTF-16 texts in a third, phrases only hold offsets into them.
+ * TKeys supplies the platform's records, see CompilePhraseTable(). */
+template<typename TKeys>
+struct BasicPhraseTable
+{
+	uint64_t								Revision;	/* of the config snapshot this was compiled from, set by the caller */
+	std::vector<typename TKeys::Input>		Inputs;
+	std::vector<typename TKeys::Message>	Messages;
+	std::vector<wchar_t>					Text;
+	InputRun								Open;						/* return stroke */
+	InputRun								Paste;						/* lctrl press, v stroke */
+	InputRun								PasteSubmit;				/* lctrl release, return stroke */
+	InputRun								PasteCancel;				/* lctrl release */
+	InputRun								TypeSubmit[MAX_PHRASES];	/* unicode text, return stroke */
+	InputRun								OpenMessages;				/* return stroke */
+	InputRun								TypeSubmitMessages[MAX_PHRASES];	/* a character message per UTF-16 unit, return stroke */
+	size_t									TextOffset[MAX_PHRASES];
+};
+
+/* Compiles every phrase of aConfig into aTable, reusing its arenas. TKeys provides
+ * - Input and Message, the records sent and posted
+ * - Key(aKey, aRelease) and Unicode(aUnit, aRelease), one input each
+ * - AppendKeyMessages(aMessages, aKey) and Char(aUnit), the window messages of a key stroke and a typed unit */
+template<typename TKeys>
+void CompilePhraseTable(BasicPhraseTable<TKeys>& aTable, const AddonConfig* aConfig, const TKeys& aKeys)
+{
+	BasicPhraseTable<TKeys>& table = aTable;
+	table.Inputs.clear();
+	table.Messages.clear();
+	table.Text.clear();
+
+	auto begin = [&table]() { return InputRun{ table.Inputs.size(), 0 }; };
+	auto end = [&table](InputRun& aRun) { aRun.Count = table.Inputs.size() - aRun.Offset; };
+
+	table.Open = begin();
+	table.Inputs.push_back(aKeys.Key(EKey::Return, false));
+	table.Inputs.push_back(aKeys.Key(EKey::Return, true));
+	end(table.Open);
+
+	table.Paste = begin();
+	table.Inputs.push_back(aKeys.Key(EKey::Control, false));
+	table.Inputs.push_back(aKeys.Key(EKey::V, false));
+	table.Inputs.push_back(aKeys.Key(EKey::V, true));
+	end(table.Paste);
+
+	table.PasteSubmit = begin();
+	table.Inputs.push_back(aKeys.Key(EKey::Control, true));
+	table.Inputs.push_back(aKeys.Key(EKey::Return, false));
+	table.Inputs.push_back(aKeys.Key(EKey::Return, true));
+	end(table.PasteSubmit);
+
+	table.PasteCancel = begin();
+	table.Inputs.push_back(aKeys.Key(EKey::Control, true));
+	end(table.PasteCancel);
+
+	for (size_t i = 0; i < MAX_PHRASES; i++)
+	{
+		/* slots past PhraseCount compile to an empty text, the pipeline never sends them */
+		const char* phrase = i < static_cast<size_t>(aConfig->PhraseCount) ? aConfig->Phrases[i] : "";
+
+		table.TextOffset[i] = table.Text.size();
+		AppendUtf16(table.Text, phrase);
+
+		/* one key down and one key up per UTF-16 code unit, surrogate pairs are sent as two units like a real IME would */
+		table.TypeSubmit[i] = begin();
+		for (size_t c = table.TextOffset[i]; table.Text[c]; c++)
+		{
+			table.Inputs.push_back(aKeys.Unicode(table.Text[c], false));
+			table.Inputs.push_back(aKeys.Unicode(table.Text[c], true));
+		}
+		table.Inputs.push_back(aKeys.Key(EKey::Return, false));
+		table.Inputs.push_back(aKeys.Key(EKey::Return, true));
+		end(table.TypeSubmit[i]);
+	}
+
+	/* the same for the window message backend, text goes straight in as character messages so no keyboard state is involved */
+	table.OpenMessages = InputRun{ table.Messages.size(), 0 };
+	aKeys.AppendKeyMessages(table.Messages, EKey::Return);
+	table.OpenMessages.Count = table.Messages.size() - table.OpenMessages.Offset;
+
+	for (size_t i = 0; i < MAX_PHRASES; i++)
+	{
+		InputRun& run = table.TypeSubmitMessages[i];
+		run = InputRun{ table.Messages.size(), 0 };
+		for (size_t c = table.TextOffset[i]; table.Text[c]; c++)
+		{
+			table.Messages.push_back(aKeys.Char(table.Text[c]));
+		}
+		aKeys.AppendKeyMessages(table.Messages, EKey::Return);
+		run.Count = table.Messages.size() - run.Offset;
+	}
+}
@@ -0,0 +1,219 @@
+#include "Pipeline.h"
+
+const char* StageNames[static_cast<int>(EStage::COUNT)] = {
+	"Trigger",
+	"Clipboard acquire",
+	"Clipboard set",
+	"Return sent",
+	"Textbox focused",
+	"Paste sent",
+	"Message sent",
+	"Clipboard restored"
+};
+
+namespace
+{
+	struct StageTimer
+	{
+		CGGPipeline&	Pipeline;
+		IClock&			Clock;
+		long long		Last;
+
+		void Mark(EStage aStage)
+		{
+			long long now = Clock.Now();
+			Pipeline.StageLatency[static_cast<int>(aStage)].Record(static_cast<unsigned long long>(now - Last));
+			Last = now;
+		}
+	};
+}
+
+unsigned CGGPipeline::Run(const Trigger* aTriggers, size_t aCount, const AddonConfig& aConfig)
+{
+	if (aCount == 0)
+	{
+		return 0;
+	}
+
+	StageTimer timer{ *this, Clock, Clock.Now() };
+	for (size_t i = 0; i < aCount; i++)
+	{
+		StageLatency[static_cast<int>(EStage::Trigger)].Record(static_cast<unsigned long long>(timer.Last - aTriggers[i].Timestamp));
+	}
+
+	/* while the restore is pending the clipboard holds our phrase and the saved copy is still what the user had.
+	 * if no frame showed the chat opened again since our own last submit, an open chat is still ours with that submit on its way:
+	 * this batch follows it like the next message of the same batch would, instead of waiting for the chat to close.
+	 * a chat opened since is the player's, sending Return into it would submit their draft. */
+	bool isRestorePending = IsRestorePending();
+	bool isContinuation = isRestorePending && Game.TextboxOpenings() == OpeningsAtSubmit;
+
+	if ((!isContinuation && Game.IsTextboxFocused()) || !Game.IsInInstance())
+	{
+		Skipped += aCount;
+		return 0;
+	}
+
+	bool useClipboard = aConfig.InjectionMode == EInjectionMode::Clipboard;
+	bool hasSaved = isRestorePending;
+	unsigned sent = 0;
+
+	for (size_t i = 0; i < aCount; i++)
+	{
+		if (IsCancelled())
+		{
+			Skipped += aCount - i;
+			break;
+		}
+
+		/* the palette may have shrunk since the trigger was queued */
+		unsigned phrase = aTriggers[i].Phrase;
+		if (phrase >= static_cast<unsigned>(aConfig.PhraseCount) || aConfig.Phrases[phrase][0] == '\0' || !Game.IsInInstance())
+		{
+			Skipped++;
+			continue;
+		}
+
+		if (useClipboard)
+		{
+			/* pasting without our phrase on the clipboard would send whatever is on it */
+			if (!AcquireClipboard())
+			{
+				Failed += aCount - i;
+				break;
+			}
+			timer.Mark(EStage::ClipboardAcquire);
+
+			/* only the first message sees what the user had, later ones would save our own phrase */
+			if (!hasSaved)
+			{
+				HasPrevious = Clipboard.Save();
+				hasSaved = true;
+			}
+			Clipboard.SetText(Input.Text(phrase));
+			Clipboard.Close();
+
+			timer.Mark(EStage::ClipboardSet);
+		}
+
+		/* for every message after the first this follows the previous submit straight away, keystrokes are processed in order */
+		Input.Send(EKeySequence::Open, phrase);
+		timer.Mark(EStage::ReturnSent);
+
+		if (!WaitUntil([this] { return Game.IsTextboxFocused(); }, FOCUS_WAIT_FRAMES, FOCUS_WAIT_TIMEOUT))
+		{
+			Failed += aCount - i;
+			break;
+		}
+		timer.Mark(EStage::TextboxFocused);
+
+		if (useClipboard)
+		{
+			Input.Send(EKeySequence::Paste, phrase);
+			timer.Mark(EStage::PasteSent);
+
+			/* give the game time to read the clipboard before the message is sent or the clipboard changes again */
+			WaitUntil([] { return false; }, PASTE_WAIT_FRAMES, PASTE_WAIT_TIMEOUT);
+
+			/* cut short, the game may not have read the clipboard yet: submitting now could post what the user had copied.
+			 * lctrl is still down from the paste, it is released without the Return and the clipboard is restored on the way out. */
+			if (IsCancelled())
+			{
+				Input.Send(EKeySequence::PasteCancel, phrase);
+				Failed += aCount - i;
+				break;
+			}
+
+			Input.Send(EKeySequence::PasteSubmit, phrase);
+		}
+		else
+		{
+			Input.Send(EKeySequence::TypeSubmit, phrase);
+		}
+		timer.Mark(EStage::MessageSent);
+		LastMessageSent = timer.Last;
+		OpeningsAtSubmit = Game.TextboxOpenings();
+
+		Sent++;
+		sent++;
+	}
+
+	if (hasSaved && aConfig.RestoreClipboard)
+	{
+		PendingRestoreDeadline = Clock.Now() + std::chrono::duration_cast<std::chrono::microseconds>(RESTORE_WAIT_TIMEOUT).count();
+		RestorePending.store(true, std::memory_order_release);
+	}
+	else
+	{
+		RestorePending.store(false, std::memory_order_release);
+	}
+
+	Batches++;
+	BatchDuration.Record(static_cast<unsigned long long>(Clock.Now() - aTriggers[0].Timestamp));
+	return sent;
+}
+
+bool CGGPipeline::FinishRestore(bool aForce)
+{
+	if (!IsRestorePending())
+	{
+		return true;
+	}
+
+	if (!aForce && Game.IsTextboxFocused() && Clock.Now() < PendingRestoreDeadline)
+	{
+		return false;
+	}
+
+	Restore();
+	return true;
+}
+
+void CGGPipeline::Restore()
+{
+	/* the whole snapshot goes back between one Open() and Close(), nobody can read the clipboard half written */
+	if (HasPrevious && AcquireClipboard())
+	{
+		Clipboard.Restore();
+		Clipboard.Close();
+
+		StageLatency[static_cast<int>(EStage::ClipboardRestored)].Record(static_cast<unsigned long long>(Clock.Now() - LastMessageSent));
+	}
+
+	HasPrevious = false;
+	RestorePending.store(false, std::memory_order_release);
+}
+
+bool CGGPipeline::AcquireClipboard()
+{
+	long long start = Clock.Now();
+	long long deadline = start + std::chrono::duration_cast<std::chrono::microseconds>(CLIPBOARD_OPEN_TIMEOUT).count();
+	long long backoff = CLIPBOARD_BACKOFF_MIN.count();
+
+	for (unsigned retries = 0;; retries++)
+	{
+		ClipboardAttempts++;
+		if (Clipboard.Open())
+		{
+			if (retries > 0)
+			{
+				ClipboardContended++;
+				ClipboardWait.Record(static_cast<unsigned long long>(Clock.Now() - start));
+			}
+			return true;
+		}
+
+		long long now = Clock.Now();
+		if (now >= deadline || IsCancelled())
+		{
+			ClipboardFailures++;
+			ClipboardWait.Record(static_cast<unsigned long long>(now - start));
+			return false;
+		}
+
+		/* short steps keep cancellation responsive */
+		ClipboardRetries++;
+		Clock.SleepUntil(now + backoff < deadline ? now + backoff : deadline);
+		backoff = backoff * 2 < CLIPBOARD_BACKOFF_MAX.count() ? backoff * 2 : CLIPBOARD_BACKOFF_MAX.count();
+	}
+}
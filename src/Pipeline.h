@@ -0,0 +1,186 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+#include "Cancellation.h"
+#include "Histogram.h"
+#include "Settings.h"
+#include "TriggerQueue.h"
+
+/* The runs of keys a GG is made of, each one is sent in a single call. */
+enum class EKeySequence : int
+{
+	Open,			/* return stroke */
+	Paste,			/* lctrl press, v stroke */
+	PasteSubmit,	/* lctrl release, return stroke */
+	TypeSubmit,		/* typed phrase, return stroke */
+	PasteCancel		/* lctrl release, ends a paste that is not submitted */
+};
+constexpr int KEY_SEQUENCE_COUNT = static_cast<int>(EKeySequence::PasteCancel) + 1;
+
+/* Each stage records the time since the previous one, the first one since the trigger was queued.
+ * In a batch the message stages repeat once per message. */
+enum class EStage : int
+{
+	Trigger,
+	ClipboardAcquire,
+	ClipboardSet,
+	ReturnSent,
+	TextboxFocused,
+	PasteSent,
+	MessageSent,
+	ClipboardRestored,
+	COUNT
+};
+
+extern const char* StageNames[static_cast<int>(EStage::COUNT)];
+
+class IInput
+{
+public:
+	virtual ~IInput() = default;
+	virtual void Send(EKeySequence aSequence, unsigned aPhrase) = 0;
+
+	/* The phrase as compiled for sending, handed to the clipboard when pasting. */
+	virtual const wchar_t* Text(unsigned aPhrase) = 0;
+};
+
+class IClipboard
+{
+public:
+	virtual ~IClipboard() = default;
+	virtual bool Open() = 0;
+	virtual void Close() = 0;
+
+	/* The following are only called while the clipboard is open. */
+	virtual bool Save() = 0;	/* keeps a copy of the current contents, false if there was nothing to keep */
+	virtual void SetText(const wchar_t* aText) = 0;
+	virtual void Restore() = 0;	/* writes the saved copy back */
+};
+
+class IClock
+{
+public:
+	virtual ~IClock() = default;
+	virtual long long Now() = 0; /* microseconds */
+	virtual void SleepUntil(long long aTime) = 0;
+};
+
+class IGameState
+{
+public:
+	virtual ~IGameState() = default;
+	virtual bool IsTextboxFocused() = 0;
+	virtual bool IsInInstance() = 0;
+
+	/* How often the textbox went from closed to open so far, counted from the published frames. */
+	virtual unsigned TextboxOpenings() = 0;
+
+	/* Blocks until the game publishes its next frame, false if aDeadline (IClock time) passed first. */
+	virtual bool WaitNextFrame(long long aDeadline) = 0;
+};
+
+/* MumbleLink only changes once per frame, so every wait is bounded in frames as well as in time */
+constexpr unsigned FOCUS_WAIT_FRAMES = 10;
+constexpr std::chrono::milliseconds FOCUS_WAIT_TIMEOUT{ 500 };
+constexpr unsigned PASTE_WAIT_FRAMES = 3;
+constexpr std::chrono::milliseconds PASTE_WAIT_TIMEOUT{ 50 };
+
+/* a pending restore runs when the chat closes, or after this long if it stays open */
+constexpr std::chrono::milliseconds RESTORE_WAIT_TIMEOUT{ 1000 };
+
+/* another process holding the clipboard is retried with exponential backoff until the deadline */
+constexpr std::chrono::microseconds CLIPBOARD_BACKOFF_MIN{ 500 };
+constexpr std::chrono::microseconds CLIPBOARD_BACKOFF_MAX{ 8000 };
+constexpr std::chrono::milliseconds CLIPBOARD_OPEN_TIMEOUT{ 100 };
+
+/* One batch of messages from trigger to restored clipboard, with every side effect behind an interface so it can run against fakes. */
+class CGGPipeline
+{
+public:
+	/* Once aCancel is set, no further message is started and every wait gives up. */
+	CGGPipeline(IInput& aInput, IClipboard& aClipboard, IGameState& aGame, IClock& aClock, const CCancellation* aCancel = nullptr)
+		: Input(aInput), Clipboard(aClipboard), Game(aGame), Clock(aClock), Cancel(aCancel)
+	{
+	}
+
+	/* Sends every message back to back in one chat session: the clipboard is saved before the first and restored once the chat closes after the last.
+	 * A message is skipped when the phrase is gone, the player is not in an instance or, for the first one, the chat was already open.
+	 * An open chat is only ours while the restore is pending and it was not opened again since our last submit.
+	 * If the chat does not open, the message and all after it fail. Returns how many were sent. */
+	unsigned Run(const Trigger* aTriggers, size_t aCount, const AddonConfig& aConfig);
+
+	/* Run() does not wait for the chat to close, it leaves the restore pending. Whoever calls Run() calls this once the chat closed
+	 * or RestoreDeadline() passed, always from the same thread, so a restore never overlaps a paste.
+	 * A batch that starts while the restore is pending keeps the saved copy, its phrase never becomes "what the user had".
+	 * Returns false if the restore is still waiting for the chat to close, aForce restores regardless. */
+	bool FinishRestore(bool aForce = false);
+
+	bool IsRestorePending() const
+	{
+		return RestorePending.load(std::memory_order_acquire);
+	}
+
+	long long RestoreDeadline() const
+	{
+		return PendingRestoreDeadline;
+	}
+
+	CHistogram						StageLatency[static_cast<int>(EStage::COUNT)]; /* microseconds */
+	CHistogram						BatchDuration; /* microseconds, from the first trigger to the end of the batch */
+
+	std::atomic<unsigned long long>	Sent{ 0 };
+	std::atomic<unsigned long long>	Skipped{ 0 };
+	std::atomic<unsigned long long>	Failed{ 0 };
+	std::atomic<unsigned long long>	Batches{ 0 };
+
+	CHistogram						ClipboardWait; /* microseconds spent acquiring the clipboard, recorded when it was contended */
+	std::atomic<unsigned long long>	ClipboardAttempts{ 0 };
+	std::atomic<unsigned long long>	ClipboardRetries{ 0 };
+	std::atomic<unsigned long long>	ClipboardContended{ 0 };	/* acquisitions that needed at least one retry */
+	std::atomic<unsigned long long>	ClipboardFailures{ 0 };	/* gave up at the deadline */
+
+private:
+	void Restore();
+
+	/* Opens the clipboard, backing off while someone else holds it. False if the deadline passed or the pipeline was cancelled. */
+	bool AcquireClipboard();
+
+	/* Checks aCondition once now and once per frame, gives up after aMaxFrames frames or aTimeout. */
+	template<typename Pred>
+	bool WaitUntil(Pred aCondition, unsigned aMaxFrames, std::chrono::milliseconds aTimeout)
+	{
+		long long deadline = Clock.Now() + std::chrono::duration_cast<std::chrono::microseconds>(aTimeout).count();
+
+		for (unsigned frames = 0;; frames++)
+		{
+			if (aCondition())
+			{
+				return true;
+			}
+
+			if (frames >= aMaxFrames || IsCancelled() || !Game.WaitNextFrame(deadline))
+			{
+				return false;
+			}
+		}
+	}
+
+	bool IsCancelled() const
+	{
+		return Cancel && Cancel->IsCancelled();
+	}
+
+	IInput&					Input;
+	IClipboard&				Clipboard;
+	IGameState&				Game;
+	IClock&					Clock;
+	const CCancellation*	Cancel;
+
+	std::atomic<bool>		RestorePending{ false };
+	bool					HasPrevious = false;
+	long long				PendingRestoreDeadline = 0;
+	long long				LastMessageSent = 0;
+	unsigned				OpeningsAtSubmit = 0;	/* TextboxOpenings() when the last message was submitted */
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/* Copies a block that another process rewrites in place and that carries its own version counter, like MumbleLink and its uiTick.
+ * The counter is read before and after the copy, the copy is retried while they differ. Returns false if it never settled. */
+template<typename T>
+bool ReadVersioned(const volatile unsigned& aVersion, const T& aBlock, T& aOut, unsigned& aVersionOut, unsigned aMaxRetries, unsigned long long& aRetries)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable.");
+
+	for (unsigned attempt = 0; attempt <= aMaxRetries; attempt++)
+	{
+		unsigned before = aVersion;
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		memcpy(&aOut, &aBlock, sizeof(T));
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		unsigned after = aVersion;
+
+		if (before == after)
+		{
+			aVersionOut = after;
+			return true;
+		}
+
+		aRetries++;
+	}
+
+	return false;
+}
+
+/* Single writer, any number of readers. Readers never block the writer, they retry if a write happened during their copy.
+ * The value is kept as relaxed atomic words, so concurrent copies are well defined. */
+template<typename T>
+class CSeqLock
+{
+	static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable.");
+
+public:
+	void Publish(const T& aValue)
+	{
+		uint64_t words[WORDS]{};
+		memcpy(words, &aValue, sizeof(T));
+
+		Sequence.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		for (size_t i = 0; i < WORDS; i++)
+		{
+			Words[i].store(words[i], std::memory_order_relaxed);
+		}
+
+		Sequence.fetch_add(1, std::memory_order_release);
+	}
+
+	T Read() const
+	{
+		uint64_t words[WORDS];
+
+		for (;;)
+		{
+			unsigned long long before = Sequence.load(std::memory_order_acquire);
+			if (before & 1)
+			{
+				continue;
+			}
+
+			for (size_t i = 0; i < WORDS; i++)
+			{
+				words[i] = Words[i].load(std::memory_order_relaxed);
+			}
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (Sequence.load(std::memory_order_relaxed) == before)
+			{
+				break;
+			}
+		}
+
+		T value;
+		memcpy(&value, words, sizeof(T));
+		return value;
+	}
+
+private:
+	static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+	std::atomic<unsigned long long>	Sequence{ 0 };
+	std::atomic<uint64_t>			Words[WORDS]{};
+};
@@ -0,0 +1,267 @@
+#include "Settings.h"
+
+#include <climits>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "nlohmann/json.hpp"
+using json = nlohmann::json;
+
+namespace
+{
+	enum class EFieldType
+	{
+		Bool,
+		Int,
+		Color,	/* unsigned 0xRRGGBBAA, stored as "#RRGGBBAA" */
+		Phrases	/* Phrases and PhraseCount, stored as an array of strings */
+	};
+
+	struct SettingsField
+	{
+		const char*	Key;
+		EFieldType	Type;
+		size_t		Offset;
+		long long	Min;	/* Int only, values outside [Min, Max] are skipped */
+		long long	Max;
+	};
+
+	/* the schema, new settings only need an entry here */
+	const SettingsField Schema[] = {
+		{ "Version",			EFieldType::Int,	offsetof(AddonConfig, Version),	0, INT_MAX },
+		{ "IsVisible",			EFieldType::Bool,	offsetof(AddonConfig, IsVisible),	0, 0 },
+		{ "RestoreClipboard",	EFieldType::Bool,	offsetof(AddonConfig, RestoreClipboard),	0, 0 },
+		{ "InjectionMode",		EFieldType::Int,	offsetof(AddonConfig, InjectionMode),		static_cast<long long>(EInjectionMode::Clipboard), static_cast<long long>(EInjectionMode::WindowMessages) },
+		{ "CoalesceWindowMs",	EFieldType::Int,	offsetof(AddonConfig, CoalesceWindowMs),	0, MAX_COALESCE_WINDOW_MS },
+		{ "Phrases",			EFieldType::Phrases,	offsetof(AddonConfig, Phrases),	0, 0 },
+		{ "HoverTint",			EFieldType::Color,	offsetof(AddonConfig, HoverTint),	0, 0 },
+		{ "PressedTint",		EFieldType::Color,	offsetof(AddonConfig, PressedTint),	0, 0 },
+		{ "HighlightBackground",	EFieldType::Color,	offsetof(AddonConfig, HighlightBackground),	0, 0 }
+	};
+
+	/* brings a file of an older version up to SETTINGS_VERSION, one step per version */
+	void Migrate(AddonConfig& aConfig)
+	{
+		if (aConfig.Version < 1)
+		{
+			/* the baseline kept IsVisible and RestoreClipboard in a json DOM, both still mean the same.
+			 * It sent every single press, keep doing that instead of coalescing them. */
+			aConfig.CoalesceWindowMs = 0;
+		}
+
+		aConfig.Version = SETTINGS_VERSION;
+	}
+
+	class SettingsReader : public nlohmann::json_sax<json>
+	{
+	public:
+		SettingsReader(AddonConfig& aConfig)
+			: Config(aConfig)
+		{
+		}
+
+		std::string	Error;
+
+		bool null() override { Field = nullptr; return true; }
+		bool boolean(bool aValue) override { return Store(EFieldType::Bool, aValue ? 1 : 0); }
+		bool number_integer(number_integer_t aValue) override { return Store(EFieldType::Int, aValue); }
+		bool number_unsigned(number_unsigned_t aValue) override { return Store(EFieldType::Int, static_cast<long long>(aValue)); }
+		bool number_float(number_float_t, const string_t&) override { Field = nullptr; return true; }
+		bool string(string_t& aValue) override { return InPhrases ? StorePhrase(aValue) : StoreColor(aValue); }
+		bool binary(binary_t&) override { Field = nullptr; return true; }
+
+		bool start_object(std::size_t) override { Depth++; return true; }
+		bool end_object() override { Depth--; Field = nullptr; return true; }
+		bool start_array(std::size_t) override
+		{
+			if (Depth == 1 && Field && Field->Type == EFieldType::Phrases)
+			{
+				InPhrases = true;
+				PhraseCount = 0;
+			}
+			Depth++;
+			return true;
+		}
+
+		bool end_array() override
+		{
+			Depth--;
+			if (Depth == 1 && InPhrases)
+			{
+				/* an empty palette keeps the default one */
+				if (PhraseCount > 0)
+				{
+					Config.PhraseCount = PhraseCount;
+				}
+				InPhrases = false;
+			}
+			Field = nullptr;
+			return true;
+		}
+
+		bool key(string_t& aKey) override
+		{
+			Field = nullptr;
+
+			/* only top level keys belong to the schema, anything nested is skipped */
+			if (Depth != 1)
+			{
+				return true;
+			}
+
+			for (const SettingsField& field : Schema)
+			{
+				if (aKey == field.Key)
+				{
+					Field = &field;
+					break;
+				}
+			}
+
+			return true;
+		}
+
+		bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& aException) override
+		{
+			Error = aException.what();
+			return false;
+		}
+
+	private:
+		bool Store(EFieldType aType, long long aValue)
+		{
+			if (Depth != 1)
+			{
+				return true;
+			}
+
+			if (Field && Field->Type == aType)
+			{
+				char* dst = reinterpret_cast<char*>(&Config) + Field->Offset;
+				if (aType == EFieldType::Bool)
+				{
+					*reinterpret_cast<bool*>(dst) = aValue != 0;
+				}
+				else if (aValue >= Field->Min && aValue <= Field->Max)
+				{
+					int value = static_cast<int>(aValue);
+					memcpy(dst, &value, sizeof(int));
+				}
+			}
+
+			Field = nullptr;
+			return true;
+		}
+
+		bool StoreColor(const string_t& aValue)
+		{
+			if (Depth == 1 && Field && Field->Type == EFieldType::Color && aValue.size() == 9 && aValue[0] == '#')
+			{
+				char* end = nullptr;
+				unsigned long value = strtoul(aValue.c_str() + 1, &end, 16);
+				if (*end == '\0')
+				{
+					unsigned color = static_cast<unsigned>(value);
+					memcpy(reinterpret_cast<char*>(&Config) + Field->Offset, &color, sizeof(unsigned));
+				}
+			}
+
+			Field = nullptr;
+			return true;
+		}
+
+		bool StorePhrase(const string_t& aValue)
+		{
+			if (Depth != 2 || PhraseCount >= static_cast<int>(MAX_PHRASES))
+			{
+				return true;
+			}
+
+			/* cut overlong phrases on a character boundary */
+			size_t len = aValue.size() < PHRASE_LENGTH - 1 ? aValue.size() : PHRASE_LENGTH - 1;
+			while (len < aValue.size() && len > 0 && (static_cast<unsigned char>(aValue[len]) & 0xC0) == 0x80)
+			{
+				len--;
+			}
+
+			char* phrase = Config.Phrases[PhraseCount++];
+			memcpy(phrase, aValue.data(), len);
+			phrase[len] = '\0';
+			return true;
+		}
+
+		AddonConfig&			Config;
+		const SettingsField*	Field = nullptr;
+		bool					InPhrases = false;
+		int						PhraseCount = 0;
+		int						Depth = 0;
+	};
+}
+
+bool ReadSettings(std::istream& aStream, AddonConfig& aConfig, std::string& aError)
+{
+	AddonConfig config = aConfig;
+	config.Version = 0;
+	SettingsReader reader(config);
+
+	if (!json::sax_parse(aStream, &reader))
+	{
+		aError = reader.Error;
+		return false;
+	}
+
+	if (config.Version < SETTINGS_VERSION)
+	{
+		Migrate(config);
+	}
+
+	aConfig = config;
+	return true;
+}
+
+bool WriteSettings(std::ostream& aStream, const AddonConfig& aConfig)
+{
+	if (aConfig.Version > SETTINGS_VERSION)
+	{
+		return false;
+	}
+
+	const char* base = reinterpret_cast<const char*>(&aConfig);
+
+	aStream << "{";
+	for (const SettingsField& field : Schema)
+	{
+		aStream << (&field == Schema ? "\n\t\"" : ",\n\t\"") << field.Key << "\": ";
+		if (field.Type == EFieldType::Bool)
+		{
+			aStream << (*reinterpret_cast<const bool*>(base + field.Offset) ? "true" : "false");
+		}
+		else if (field.Type == EFieldType::Phrases)
+		{
+			aStream << "[";
+			for (int i = 0; i < aConfig.PhraseCount; i++)
+			{
+				aStream << (i > 0 ? ",\n\t\t" : "\n\t\t") << json(aConfig.Phrases[i]).dump();
+			}
+			aStream << "\n\t]";
+		}
+		else if (field.Type == EFieldType::Color)
+		{
+			unsigned value;
+			memcpy(&value, base + field.Offset, sizeof(unsigned));
+			char buff[16];
+			snprintf(buff, sizeof(buff), "\"#%08X\"", value);
+			aStream << buff;
+		}
+		else
+		{
+			int value;
+			memcpy(&value, base + field.Offset, sizeof(int));
+			aStream << value;
+		}
+	}
+	aStream << "\n}" << std::endl;
+	return true;
+}
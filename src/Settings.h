@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+
+enum class EInjectionMode : int
+{
+	Clipboard,		/* paste through the clipboard with Ctrl+V */
+	Unicode,		/* type the text as KEYEVENTF_UNICODE key events */
+	WindowMessages	/* post the keys and the text as WM_KEYDOWN/WM_CHAR/WM_KEYUP to the game window */
+};
+
+constexpr size_t MAX_PHRASES = 8;
+constexpr size_t PHRASE_LENGTH = 256; /* bytes of UTF-8 including the terminator */
+constexpr int MAX_COALESCE_WINDOW_MS = 5000;
+
+/* The file format written by this build, bump it when the meaning of a stored key changes and teach Migrate() in Settings.cpp the step.
+ * Files from the baseline have no "Version" key and count as 0. */
+constexpr int SETTINGS_VERSION = 1;
+
+/* Everything the user can configure. Never modified in place, see CSnapshot. */
+struct AddonConfig
+{
+	int				Version = SETTINGS_VERSION;	/* of the file read, above SETTINGS_VERSION when a newer SlashGG wrote it */
+	bool			IsVisible = true;
+	bool			RestoreClipboard = true;
+	EInjectionMode	InjectionMode = EInjectionMode::Clipboard;
+	int				CoalesceWindowMs = 50;	/* a debounce for a bouncing key or a double click, deliberate presses are further apart */
+
+	/* the palette, the first phrase is the icon button and KB_SUDOKU */
+	char			Phrases[MAX_PHRASES][PHRASE_LENGTH] = { "/gg" };
+	int				PhraseCount = 1;
+
+	/* colours as 0xRRGGBBAA, the button icon is multiplied by the tint and drawn over the background */
+	unsigned		HoverTint = 0xC0FFC0FF;
+	unsigned		PressedTint = 0x9A9A9AFF;
+	unsigned		HighlightBackground = 0x00000000;	/* behind the icon while hovered or pressed */
+};
+
+/* Reads settings.json in a single streaming pass straight into aConfig, without building a document.
+ * Unknown keys, values of the wrong type and values out of range are skipped, keeping what aConfig had. On a malformed file aConfig is left untouched and aError says why.
+ * An older file is migrated to SETTINGS_VERSION. A newer one is read as far as this build knows it and keeps its Version, see WriteSettings(). */
+bool ReadSettings(std::istream& aStream, AddonConfig& aConfig, std::string& aError);
+
+/* Returns false and writes nothing for a config read from a newer file, saving it would drop whatever only the newer SlashGG knows. */
+bool WriteSettings(std::ostream& aStream, const AddonConfig& aConfig);
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include "Cancellation.h"
+
+/* Auto-reset event built on the standard library so it behaves the same on every platform.
+ * A Notify() that happens before Wait() is not lost, multiple Notify() calls collapse into one wakeup. */
+class CSignal
+{
+public:
+	void Notify()
+	{
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			IsSet = true;
+		}
+		Condition.notify_one();
+	}
+
+	void Wait()
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		Condition.wait(lock, [this] { return IsSet; });
+		IsSet = false;
+	}
+
+	/* Also returns once aCancel is set, provided the canceller calls Notify() afterwards. False if cancelled. */
+	bool Wait(const CCancellation& aCancel)
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		Condition.wait(lock, [this, &aCancel] { return IsSet || aCancel.IsCancelled(); });
+		IsSet = false;
+		return !aCancel.IsCancelled();
+	}
+
+	/* Like Wait(aCancel), but also returns once aDeadline passed. False if cancelled. */
+	bool WaitUntil(std::chrono::steady_clock::time_point aDeadline, const CCancellation& aCancel)
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		Condition.wait_until(lock, aDeadline, [this, &aCancel] { return IsSet || aCancel.IsCancelled(); });
+		IsSet = false;
+		return !aCancel.IsCancelled();
+	}
+
+private:
+	std::mutex				Mutex;
+	std::condition_variable	Condition;
+	bool					IsSet = false;
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/* Immutable value shared between threads, RCU style.
+ * Readers grab the current version with a single atomic load and never block.
+ * Writers copy it, modify the copy and swap it in. A replaced version is freed by a later Update() once every reader passed a quiescent point since,
+ * so a reader may keep what Get() returned until its next Quiescent() or Offline().
+ * Every thread that calls Get() owns one of the Readers slots and is online while it does. Reclaim() frees the rest once no reader is left, e.g. on unload. */
+template<typename T, size_t Readers = 4>
+class CSnapshot
+{
+public:
+	CSnapshot()
+		: Current(new T())
+	{
+		for (std::atomic<uint64_t>& slot : Slots)
+		{
+			slot.store(OFFLINE, std::memory_order_relaxed);
+		}
+	}
+
+	~CSnapshot()
+	{
+		Reclaim();
+		delete Current.load();
+	}
+
+	/* seq_cst pairs with the slot store of Online() against the exchange and slot scan of Update(): either Update() sees the reader online or the reader sees the new version.
+	 * On x86 it is the same plain load as acquire. */
+	const T* Get() const
+	{
+		return Current.load(std::memory_order_seq_cst);
+	}
+
+	/* Bumped by every Update(), read it before Get() to tell whether something derived from an earlier version is stale. */
+	uint64_t Revision() const
+	{
+		return Epoch.load(std::memory_order_acquire);
+	}
+
+	template<typename F>
+	void Update(F aModify)
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+
+		T* next = new T(*Current.load(std::memory_order_relaxed));
+		aModify(*next);
+
+		T* previous = Current.exchange(next, std::memory_order_seq_cst);
+		uint64_t retiredAt = Epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+		Retired.emplace_back(retiredAt, std::unique_ptr<T>(previous));
+
+		Collect();
+	}
+
+	/* aReader starts reading, every version it gets from now on is kept for it. */
+	void Online(size_t aReader)
+	{
+		Slots[aReader].store(Epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+	}
+
+	/* aReader holds nothing it got before this call anymore. */
+	void Quiescent(size_t aReader)
+	{
+		Online(aReader);
+	}
+
+	/* aReader holds nothing and does not read until it is online again, e.g. while it waits. */
+	void Offline(size_t aReader)
+	{
+		Slots[aReader].store(OFFLINE, std::memory_order_seq_cst);
+	}
+
+	/* Only once every reader is offline. */
+	void Reclaim()
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Retired.clear();
+	}
+
+	/* Versions replaced but not freed yet, for diagnostics. */
+	size_t Pending()
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		return Retired.size();
+	}
+
+private:
+	static constexpr uint64_t OFFLINE = ~0ull;
+
+	/* a version retired at epoch e is unreachable once every online reader announced an epoch of at least e */
+	void Collect()
+	{
+		uint64_t oldest = OFFLINE;
+		for (const std::atomic<uint64_t>& slot : Slots)
+		{
+			uint64_t seen = slot.load(std::memory_order_seq_cst);
+			if (seen < oldest)
+			{
+				oldest = seen;
+			}
+		}
+
+		size_t kept = 0;
+		for (size_t i = 0; i < Retired.size(); i++)
+		{
+			if (Retired[i].first > oldest)
+			{
+				Retired[kept++] = std::move(Retired[i]);
+			}
+		}
+		Retired.resize(kept);
+	}
+
+	std::atomic<T*>										Current;
+	std::atomic<uint64_t>								Epoch{ 0 };
+	std::atomic<uint64_t>								Slots[Readers];
+	std::mutex											Mutex;
+	std::vector<std::pair<uint64_t, std::unique_ptr<T>>>	Retired;
+};
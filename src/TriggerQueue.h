@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+enum class ETriggerSource : unsigned char
+{
+	Keybind,
+	Button
+};
+
+struct Trigger
+{
+	ETriggerSource	Source;
+	unsigned char	Phrase;
+	long long		Timestamp; /* steady clock, microseconds */
+};
+
+inline long long TriggerTimestamp()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Bounded lock-free queue, any number of producers and exactly one consumer.
+ * Every cell carries a sequence number, producers claim a slot with one CAS on the tail and publish it by bumping the sequence.
+ * Triggers arriving within CoalesceWindowMs of the last accepted trigger for the same phrase are folded into it, 0 runs every single one. */
+template<size_t Capacity, size_t Phrases = 1>
+class CTriggerQueue
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+	static_assert(Phrases >= 1 && Phrases <= 256, "Phrases must fit Trigger::Phrase.");
+
+public:
+	CTriggerQueue()
+	{
+		for (size_t i = 0; i < Capacity; i++)
+		{
+			Cells[i].Sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	/* Returns true if the trigger was queued, false if it was coalesced, the queue is full or aPhrase is out of range. */
+	bool Push(ETriggerSource aSource, unsigned aPhrase = 0)
+	{
+		if (aPhrase >= Phrases)
+		{
+			Dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		long long now = TriggerTimestamp();
+		long long window = static_cast<long long>(CoalesceWindowMs.load(std::memory_order_relaxed)) * 1000;
+
+		std::atomic<long long>& lastAccepted = LastAccepted[aPhrase];
+		long long last = lastAccepted.load(std::memory_order_relaxed);
+		if (window > 0)
+		{
+			do
+			{
+				if (now - last < window)
+				{
+					Coalesced.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				}
+			} while (!lastAccepted.compare_exchange_weak(last, now, std::memory_order_relaxed));
+		}
+
+		Cell* cell;
+		size_t pos = Tail.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			cell = &Cells[pos & (Capacity - 1)];
+			size_t seq = cell->Sequence.load(std::memory_order_acquire);
+			intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+			if (diff == 0)
+			{
+				if (Tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (diff < 0)
+			{
+				/* a dropped trigger must not hold off the next one for the window, unless another producer got in since */
+				if (window > 0)
+				{
+					lastAccepted.compare_exchange_strong(now, last, std::memory_order_relaxed);
+				}
+				Dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			else
+			{
+				pos = Tail.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->Value = Trigger{ aSource, static_cast<unsigned char>(aPhrase), now };
+		cell->Sequence.store(pos + 1, std::memory_order_release);
+
+		Enqueued.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	/* Consumer only. */
+	bool Pop(Trigger& aOut)
+	{
+		Cell* cell = &Cells[Head & (Capacity - 1)];
+		size_t seq = cell->Sequence.load(std::memory_order_acquire);
+
+		if (seq != Head + 1)
+		{
+			return false;
+		}
+
+		aOut = cell->Value;
+		cell->Sequence.store(Head + Capacity, std::memory_order_release);
+		Head++;
+		return true;
+	}
+
+	std::atomic<unsigned>			CoalesceWindowMs{ 0 };
+
+	std::atomic<unsigned long long>	Enqueued{ 0 };
+	std::atomic<unsigned long long>	Coalesced{ 0 };
+	std::atomic<unsigned long long>	Dropped{ 0 };
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t>	Sequence;
+		Trigger				Value;
+	};
+
+	alignas(64) Cell				Cells[Capacity];
+	alignas(64) std::atomic<size_t>	Tail{ 0 };
+	alignas(64) size_t				Head = 0;
+	alignas(64) std::atomic<long long>	LastAccepted[Phrases]{};
+};
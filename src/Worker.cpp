@@ -0,0 +1,58 @@
+#include "Worker.h"
+
+void CGGWorker::Start()
+{
+	Cancel.Reset();
+	Thread = std::thread(&CGGWorker::Run, this);
+}
+
+void CGGWorker::Stop()
+{
+	/* every wait of the worker checks the token, cancelling and waking them bounds the join by the current SendInput or clipboard call */
+	Cancel.Cancel();
+	Signal.Notify();
+	Frames.Wake();
+	if (Thread.joinable())
+	{
+		Thread.join();
+	}
+}
+
+void CGGWorker::Run()
+{
+	Host.Online();
+	Host.Started();
+
+	for (;;)
+	{
+		/* nothing of the config is kept across the wait, so the settings may free what they replace meanwhile */
+		Host.Offline();
+
+		/* PreRender signals once the chat box closed, the deadline covers a chat that stays open */
+		bool isRunning = Pipeline.IsRestorePending()
+			? Signal.WaitUntil(std::chrono::steady_clock::time_point(std::chrono::microseconds(Pipeline.RestoreDeadline())), Cancel)
+			: Signal.Wait(Cancel);
+
+		Host.Online();
+		if (!isRunning)
+		{
+			break;
+		}
+
+		Host.Woken();
+
+		/* everything queued by now goes out in one chat session, whatever arrives meanwhile makes the next one */
+		Trigger batch[WORKER_BATCH];
+		size_t count = 0;
+		while (!Cancel.IsCancelled() && (count = Host.Drain(batch, WORKER_BATCH)) > 0)
+		{
+			Host.Send(batch, count);
+		}
+
+		Pipeline.FinishRestore();
+	}
+
+	/* the paste of the last message is done by now, only the chat may still be open */
+	Pipeline.FinishRestore(true);
+	Host.Offline();
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <thread>
+
+#include "Cancellation.h"
+#include "FrameClock.h"
+#include "Pipeline.h"
+#include "Signal.h"
+#include "TriggerQueue.h"
+
+constexpr size_t WORKER_BATCH = 64; /* triggers handed to one Send() at most */
+
+/* What the worker needs from the addon around it, every call happens on the worker thread. */
+class IWorkerHost
+{
+public:
+	virtual ~IWorkerHost() = default;
+
+	/* the worker holds on to the settings between Online() and Offline(), see CSnapshot */
+	virtual void Online() = 0;
+	virtual void Offline() = 0;
+
+	/* once before the first wait, and after every wakeup before the queue is drained */
+	virtual void Started() {}
+	virtual void Woken() {}
+
+	/* moves up to aSize queued triggers into aBatch, returns how many */
+	virtual size_t Drain(Trigger* aBatch, size_t aSize) = 0;
+	virtual void Send(const Trigger* aTriggers, size_t aCount) = 0;
+};
+
+/* The thread that sends the GGs: sleeps on aSignal, drains the queue into aPipeline in batches and finishes the pending restore.
+ * aCancel is the token aPipeline was built with, Stop() sets it and wakes every wait that takes it. */
+class CGGWorker
+{
+public:
+	CGGWorker(IWorkerHost& aHost, CGGPipeline& aPipeline, CSignal& aSignal, CFrameClock& aFrames, CCancellation& aCancel)
+		: Host(aHost), Pipeline(aPipeline), Signal(aSignal), Frames(aFrames), Cancel(aCancel)
+	{
+	}
+
+	void Start();
+
+	/* Returns once the thread is gone, which takes at most the clipboard backoff step or key send it is in.
+	 * Keys are released and the clipboard is restored on the way out, whatever was still queued stays queued. */
+	void Stop();
+
+private:
+	void Run();
+
+	IWorkerHost&	Host;
+	CGGPipeline&	Pipeline;
+	CSignal&		Signal;
+	CFrameClock&	Frames;
+	CCancellation&	Cancel;
+	std::thread		Thread;
+};
@@ -1,7 +1,11 @@
+#include <atomic>
 #include <filesystem>
 #include <fstream>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "imgui/imgui.h"
 #include "ImPos/imgui_positioning.h"
@@ -13,8 +17,22 @@
 
 #include "resource.h"
 
-#include "nlohmann/json.hpp"
-using json = nlohmann::json;
+#include "Cancellation.h"
+#include "ClipboardSnapshot.h"
+#include "DeferredWriter.h"
+#include "FrameClock.h"
+#include "Histogram.h"
+#include "KeyMessages.h"
+#include "KeyNames.h"
+#include "MumbleTrace.h"
+#include "PhraseTable.h"
+#include "Pipeline.h"
+#include "SeqLock.h"
+#include "Settings.h"
+#include "Signal.h"
+#include "Snapshot.h"
+#include "TriggerQueue.h"
+#include "Worker.h"
 
 namespace ImGui
 {
@@ -38,29 +56,28 @@ namespace ImGui
 	}
 }
 
-std::map<unsigned short, std::string> ScancodeLookupTable;
+const char* GetScancodeName(unsigned short aScanCode);
 
-const char* ConvertToUTF8(const char* multibyteStr)
+/* Writes the UTF-8 form of a string in the active code page into aBuffer, see the template in KeyNames.h. Inputs longer than 255 characters are not supported. */
+size_t ConvertToUTF8(const char* aMultibyte, char* aBuffer, size_t aSize)
 {
-	char* utf8Str = nullptr;
-
-	int wideCharCount = MultiByteToWideChar(CP_ACP, 0, multibyteStr, -1, NULL, 0);
-	if (wideCharCount > 0)
+	return ConvertToUTF8(aMultibyte, aBuffer, aSize, [](const char* aText, char* aOut, size_t aOutSize) -> size_t
 	{
-		wchar_t* wideCharBuff = new wchar_t[wideCharCount];
-		MultiByteToWideChar(CP_ACP, 0, multibyteStr, -1, wideCharBuff, wideCharCount);
-
-		int utf8Count = WideCharToMultiByte(CP_UTF8, 0, wideCharBuff, -1, NULL, 0, NULL, NULL);
-		if (utf8Count > 0)
+		wchar_t wide[256];
+		int utf8Count = 0;
+		if (MultiByteToWideChar(CP_ACP, 0, aText, -1, wide, ARRAYSIZE(wide)) > 0)
 		{
-			utf8Str = new char[utf8Count];
-			WideCharToMultiByte(CP_UTF8, 0, wideCharBuff, -1, utf8Str, utf8Count, NULL, NULL);
+			utf8Count = WideCharToMultiByte(CP_UTF8, 0, wide, -1, aOut, static_cast<int>(aOutSize), NULL, NULL);
 		}
 
-		delete[] wideCharBuff;
-	}
+		if (utf8Count <= 0)
+		{
+			aOut[0] = '\0';
+			return 0;
+		}
 
-	return utf8Str;
+		return static_cast<size_t>(utf8Count - 1);
+	});
 }
 
 bool operator==(const Keybind& lhs, const Keybind& rhs)
@@ -76,148 +93,545 @@ bool operator!=(const Keybind& lhs, const Keybind& rhs)
 	return	!(lhs == rhs);
 }
 
-std::string KeybindToString(Keybind& keybind, bool padded)
+/* Interned results, the strings are never erased so the returned pointers stay valid until unload. */
+CKeybindStrings<Keybind, HKL> KeybindStrings;
+
+const char* KeybindToString(const Keybind& keybind, bool padded)
 {
 	if (keybind == Keybind{}) { return "(null)"; }
 
-	char* buff = new char[100];
-	std::string str;
+	return KeybindStrings.Get(keybind, padded, GetKeyboardLayout(0), [&keybind, padded](char* aBuffer, size_t aSize)
+	{
+		char str[256]{};
+		const char* separator = padded ? " + " : "+";
+
+		if (keybind.Alt)
+		{
+			strcat_s(str, GetScancodeName(static_cast<unsigned short>(MapVirtualKeyA(VK_MENU, MAPVK_VK_TO_VSC))));
+			strcat_s(str, separator);
+		}
+
+		if (keybind.Ctrl)
+		{
+			strcat_s(str, GetScancodeName(static_cast<unsigned short>(MapVirtualKeyA(VK_CONTROL, MAPVK_VK_TO_VSC))));
+			strcat_s(str, separator);
+		}
+
+		if (keybind.Shift)
+		{
+			strcat_s(str, GetScancodeName(static_cast<unsigned short>(MapVirtualKeyA(VK_SHIFT, MAPVK_VK_TO_VSC))));
+			strcat_s(str, separator);
+		}
+
+		strcat_s(str, GetScancodeName(keybind.Key));
+
+		for (char* c = str; *c; c++)
+		{
+			*c = static_cast<char>(toupper(static_cast<unsigned char>(*c)));
+		}
+
+		// Convert Multibyte encoding to UFT-8 bytes
+		return ConvertToUTF8(str, aBuffer, aSize);
+	});
+}
+
+/* A window message as posted to the game. */
+struct KeyMessage
+{
+	UINT	Message;
+	WPARAM	WParam;
+	LPARAM	LParam;
+};
 
-	if (keybind.Alt)
+/* Turns the keys of the phrase table into SendInput records and window messages for one keyboard layout. */
+struct Win32Keys
+{
+	using Input = INPUT;
+	using Message = KeyMessage;
+
+	HKL Layout;
+
+	static WORD VirtualKey(EKey aKey)
 	{
-		GetKeyNameTextA(MapVirtualKeyA(VK_MENU, MAPVK_VK_TO_VSC) << 16, buff, 100);
-		str.append(buff);
-		str.append(padded ? " + " : "+");
+		switch (aKey)
+		{
+		case EKey::Return:	return VK_RETURN;
+		case EKey::Control:	return VK_LCONTROL;
+		case EKey::V:		return 'V';
+		}
+		return 0;
 	}
 
-	if (keybind.Ctrl)
+	INPUT Key(EKey aKey, bool aRelease) const
 	{
-		GetKeyNameTextA(MapVirtualKeyA(VK_CONTROL, MAPVK_VK_TO_VSC) << 16, buff, 100);
-		str.append(buff);
-		str.append(padded ? " + " : "+");
+		WORD vk = VirtualKey(aKey);
+		INPUT input{};
+		input.type = INPUT_KEYBOARD;
+		input.ki.wScan = static_cast<WORD>(MapVirtualKeyExA(vk, MAPVK_VK_TO_VSC, Layout));
+		input.ki.wVk = vk;
+		input.ki.dwFlags = aRelease ? KEYEVENTF_KEYUP : 0;
+		return input;
 	}
 
-	if (keybind.Shift)
+	INPUT Unicode(wchar_t aUnit, bool aRelease) const
 	{
-		GetKeyNameTextA(MapVirtualKeyA(VK_SHIFT, MAPVK_VK_TO_VSC) << 16, buff, 100);
-		str.append(buff);
-		str.append(padded ? " + " : "+");
+		INPUT input{};
+		input.type = INPUT_KEYBOARD;
+		input.ki.wScan = aUnit;
+		input.ki.dwFlags = KEYEVENTF_UNICODE | (aRelease ? KEYEVENTF_KEYUP : 0);
+		return input;
 	}
 
-	HKL hkl = GetKeyboardLayout(0);
-	UINT vk = MapVirtualKeyA(keybind.Key, MAPVK_VSC_TO_VK);
+	void AppendKeyMessages(std::vector<KeyMessage>& aMessages, EKey aKey) const
+	{
+		/* the game's TranslateMessage() turns the key down into its WM_CHAR like for a real key */
+		WORD vk = VirtualKey(aKey);
+		unsigned short scanCode = static_cast<unsigned short>(MapVirtualKeyExA(vk, MAPVK_VK_TO_VSC_EX, Layout));
+		aMessages.push_back(KeyMessage{ WM_KEYDOWN, vk, static_cast<LPARAM>(KeyDownLParam(scanCode)) });
+		aMessages.push_back(KeyMessage{ WM_KEYUP, vk, static_cast<LPARAM>(KeyUpLParam(scanCode)) });
+	}
 
-	if (vk >= 65 && vk <= 90 || vk >= 48 && vk <= 57)
+	KeyMessage Char(wchar_t aUnit) const
 	{
-		GetKeyNameTextA(keybind.Key << 16, buff, 100);
-		str.append(buff);
+		return KeyMessage{ WM_CHAR, static_cast<WPARAM>(aUnit), static_cast<LPARAM>(KeyDownLParam(0)) };
 	}
-	else
+};
+
+using PhraseTable = BasicPhraseTable<Win32Keys>;
+
+/* Keybind identifiers per palette slot, the first one predates the palette. */
+constexpr const char* KeybindNames[MAX_PHRASES] = {
+	"KB_SUDOKU",
+	"KB_SUDOKU_PHRASE_2",
+	"KB_SUDOKU_PHRASE_3",
+	"KB_SUDOKU_PHRASE_4",
+	"KB_SUDOKU_PHRASE_5",
+	"KB_SUDOKU_PHRASE_6",
+	"KB_SUDOKU_PHRASE_7",
+	"KB_SUDOKU_PHRASE_8"
+};
+
+constexpr uint32_t HashIdentifier(const char* aIdentifier)
+{
+	/* FNV-1a */
+	uint32_t hash = 2166136261u;
+	for (; *aIdentifier; aIdentifier++)
 	{
-		auto it = ScancodeLookupTable.find(keybind.Key);
-		if (it != ScancodeLookupTable.end())
-		{
-			str.append(it->second);
-		}
+		hash = (hash ^ static_cast<unsigned char>(*aIdentifier)) * 16777619u;
 	}
-
-	delete[] buff;
-
-	std::transform(str.begin(), str.end(), str.begin(), ::toupper);
-
-	// Convert Multibyte encoding to UFT-8 bytes
-	const char* multibyte_pointer = str.c_str();
-	const char* utf8_bytes = ConvertToUTF8(multibyte_pointer);
-
-	return std::string(utf8_bytes);
+	return hash;
 }
 
-typedef struct KeystrokeMessageFlags
+/* Open addressing table from identifier hash to palette slot, built at compile time.
+ * Nexus only ever hands back identifiers we registered, so a matching hash is enough. */
+struct KeybindTable
 {
-	unsigned RepeatCount : 16;
-	unsigned ScanCode : 8;
-	unsigned ExtendedFlag : 1;
-	unsigned Reserved : 4;
-	unsigned ContextCode : 1;
-	unsigned PreviousKeyState : 1;
-	unsigned TransitionState : 1;
+	static constexpr size_t SIZE = 16;
 
-	unsigned short GetScanCode()
-	{
-		unsigned short ret = ScanCode;
+	uint32_t	Hashes[SIZE];
+	int			Phrases[SIZE];
 
-		if (ExtendedFlag)
+	constexpr int Find(uint32_t aHash) const
+	{
+		for (size_t slot = aHash & (SIZE - 1); Phrases[slot] >= 0; slot = (slot + 1) & (SIZE - 1))
 		{
-			ret |= 0xE000;
+			if (Hashes[slot] == aHash)
+			{
+				return Phrases[slot];
+			}
 		}
-
-		return ret;
+		return -1;
 	}
-} KeyLParam;
+};
 
-KeystrokeMessageFlags& LParamToKMF(LPARAM& lp)
+constexpr KeybindTable BuildKeybindTable()
 {
-	return *(KeystrokeMessageFlags*)&lp;
+	KeybindTable table{};
+	for (size_t i = 0; i < KeybindTable::SIZE; i++)
+	{
+		table.Phrases[i] = -1;
+	}
+
+	for (size_t i = 0; i < MAX_PHRASES; i++)
+	{
+		uint32_t hash = HashIdentifier(KeybindNames[i]);
+		size_t slot = hash & (KeybindTable::SIZE - 1);
+		while (table.Phrases[slot] >= 0)
+		{
+			slot = (slot + 1) & (KeybindTable::SIZE - 1);
+		}
+		table.Hashes[slot] = hash;
+		table.Phrases[slot] = static_cast<int>(i);
+	}
+	return table;
 }
 
-LPARAM& KMFToLParam(KeystrokeMessageFlags& kmf)
+constexpr KeybindTable Keybinds = BuildKeybindTable();
+
+constexpr bool KeybindsResolve()
 {
-	return *(LPARAM*)&kmf;
+	for (size_t i = 0; i < MAX_PHRASES; i++)
+	{
+		if (Keybinds.Find(HashIdentifier(KeybindNames[i])) != static_cast<int>(i))
+		{
+			return false;
+		}
+	}
+	return true;
 }
 
-LPARAM GetLPARAM(uint32_t key, bool down, bool sys)
-{
-	uint64_t lp;
-	lp = down ? 0 : 1; // transition state
-	lp = lp << 1;
-	lp += down ? 0 : 1; // previous key state
-	lp = lp << 1;
-	lp += 0; // context code
-	lp = lp << 1;
-	lp = lp << 4;
-	lp = lp << 1;
-	lp = lp << 8;
-	lp += MapVirtualKeyA(key, MAPVK_VK_TO_VSC);
-	lp = lp << 16;
-	lp += 1;
-
-	//APIDefs->Log(ELogLevel_TRACE, std::to_string(lp).c_str());
-
-	return lp;
-}
+static_assert(MAX_PHRASES < KeybindTable::SIZE, "The keybind table needs a free slot.");
+static_assert(KeybindsResolve(), "Keybind hashes collide.");
 
 void AddonLoad(AddonAPI* aApi);
 void AddonUnload();
+void LoadDeferred();
 void ProcessKeybind(const char* aIdentifier);
+void AddonPreRender();
 void AddonRender();
 void AddonOptions();
-void PerformSudoku();
+void ReceiveTexture(const char* aIdentifier, Texture* aTexture);
+void RequestRenderRegistration();
+void UpdateRenderRegistration();
+size_t DrainQueue(Trigger* aBatch, size_t aSize);
+void SendGG(const Trigger* aTriggers, size_t aCount);
+UINT AddonWndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
+
+void SendKeySequence(const InputRun& aRun);
+void PostKeyMessages(const InputRun& aRun);
+
+void DumpLatency(std::filesystem::path aPath);
 
 void LoadSettings(std::filesystem::path aPath);
 void SaveSettings(std::filesystem::path aPath);
 
-HWND Game;
+std::atomic<HWND> Game = nullptr; /* bound from the first message AddonWndProc sees */
 HMODULE hSelf;
 AddonDefinition AddonDef{};
 AddonAPI* APIDefs = nullptr;
 NexusLinkData* NexusLink = nullptr;
 Mumble::Data* MumbleLink = nullptr;
 
+/* The game rewrites MumbleLink every frame while we read it, PreRender copies it once per frame and everyone else reads that copy. */
+struct MumbleSnapshot
+{
+	unsigned		Tick;
+	Mumble::Context	Context;
+	unsigned		TextboxOpenings;	/* frames that showed the textbox open after one that showed it closed */
+};
+CSeqLock<MumbleSnapshot> MumbleState;
+unsigned long long TornMumbleReads = 0;
+bool WasTextboxFocused = false; /* render thread only, of the last published snapshot */
+unsigned TextboxOpenings = 0;
+
+/* AddonRender is only registered while the button can show at all, PreRender counts the frames it was not called for */
+std::atomic<bool> IsRenderRegistered = false;
+std::atomic<bool> RenderRegistrationDirty = false;
+unsigned long long SkippedRenderFrames = 0;
+int PublishedMapType = -1; /* render thread only, -1 until the first snapshot */
+
+CScancodeNames<HKL> ScancodeNames;
+
+std::atomic<bool> IsSettingsLoaded = false;
 std::filesystem::path AddonPath{};
-json Settings{};
 std::filesystem::path SettingsPath{};
 std::mutex Mutex;
+CDeferredWriter SettingsWriter{ std::chrono::milliseconds(500) };
 
-bool IsSlashGGButtonVisible = true;
 bool IsSlashGGButtonHovered = false;
-bool RestoreClipboard = true;
-Texture* Button = nullptr;
-Texture* ButtonHover = nullptr;
+bool IsSlashGGButtonPressed = false;
+
+/* the options edit phrases and colours in drafts and replace the config once the field or picker is let go, not on every keystroke or drag step */
+char PhraseDrafts[MAX_PHRASES][PHRASE_LENGTH]{};
+bool IsPhraseDrafted[MAX_PHRASES]{};
+ImVec4 ColorDrafts[3]{};
+bool IsColorDrafted[3]{};
+/* the threads reading Config, each reports when it holds no snapshot anymore so the replaced ones can be freed */
+enum EConfigReader
+{
+	EConfigReader_Render,
+	EConfigReader_Worker,
+	EConfigReader_Writer,
+	EConfigReader_COUNT
+};
+CSnapshot<AddonConfig, EConfigReader_COUNT> Config;
+
+/* requested once on load, the render path only looks at the ready flag. hover and pressed are tints of the same texture. */
+std::atomic<Texture*> Button = nullptr;
+std::atomic<bool> AreTexturesReady = false;
+std::atomic<unsigned long long> FrameCount = 0;
+long long TexturesRequested = 0;
+unsigned long long TexturesRequestedFrame = 0;
+std::atomic<long long> TexturesReadyAfter = -1; /* microseconds */
+std::atomic<unsigned long long> TexturesReadyAfterFrames = 0;
+
+CSignal GGSignal;
+CTriggerQueue<64, MAX_PHRASES> GGQueue;
+CCancellation GGCancel; /* every wait of the worker gives up once this is set, see CGGWorker::Stop() */
+CFrameClock Frames;
+
+PhraseTable CompiledPhrases{};
+std::atomic<HKL> KeyboardLayout = nullptr;
+std::atomic<bool> LayoutChanged = false;
+
+class CSendInputBackend : public IInput
+{
+public:
+	void Send(EKeySequence aSequence, unsigned aPhrase) override
+	{
+		switch (aSequence)
+		{
+		case EKeySequence::Open:		SendKeySequence(CompiledPhrases.Open); break;
+		case EKeySequence::Paste:		SendKeySequence(CompiledPhrases.Paste); break;
+		case EKeySequence::PasteSubmit:	SendKeySequence(CompiledPhrases.PasteSubmit); break;
+		case EKeySequence::PasteCancel:	SendKeySequence(CompiledPhrases.PasteCancel); break;
+		case EKeySequence::TypeSubmit:	SendKeySequence(CompiledPhrases.TypeSubmit[aPhrase]); break;
+		}
+	}
+
+	const wchar_t* Text(unsigned aPhrase) override
+	{
+		return &CompiledPhrases.Text[CompiledPhrases.TextOffset[aPhrase]];
+	}
+};
+
+/* Posts the keys to the game window instead of the system input queue, so they cannot interleave with what the user is typing and do not need focus.
+ * Posted messages do not change the keyboard state, Ctrl+V cannot work like this, the text is typed instead. */
+class CWindowMessageBackend : public IInput
+{
+public:
+	void Send(EKeySequence aSequence, unsigned aPhrase) override
+	{
+		switch (aSequence)
+		{
+		case EKeySequence::Open:		PostKeyMessages(CompiledPhrases.OpenMessages); break;
+		case EKeySequence::TypeSubmit:	PostKeyMessages(CompiledPhrases.TypeSubmitMessages[aPhrase]); break;
+		case EKeySequence::Paste:
+		case EKeySequence::PasteSubmit:
+		case EKeySequence::PasteCancel:
+			/* never asked for, this mode does not paste */
+			break;
+		}
+	}
+
+	const wchar_t* Text(unsigned aPhrase) override
+	{
+		return &CompiledPhrases.Text[CompiledPhrases.TextOffset[aPhrase]];
+	}
+};
+
+/* Forwards to the backend of the injection mode, picked by the worker before every batch. */
+class CInputSwitch : public IInput
+{
+public:
+	IInput* Active = nullptr;
+
+	void Send(EKeySequence aSequence, unsigned aPhrase) override
+	{
+		Active->Send(aSequence, aPhrase);
+	}
+
+	const wchar_t* Text(unsigned aPhrase) override
+	{
+		return Active->Text(aPhrase);
+	}
+};
+
+class CWin32Clipboard : public IClipboard
+{
+public:
+	bool Open() override
+	{
+		/* without the window the clipboard would be owned by no one, EmptyClipboard() then fails */
+		HWND game = Game.load(std::memory_order_relaxed);
+		return game && OpenClipboard(game);
+	}
+
+	void Close() override
+	{
+		CloseClipboard();
+	}
+
+	bool Save() override
+	{
+		Previous.Clear();
+
+		/* Windows synthesizes the narrow text formats from the unicode one again on restore */
+		bool hasUnicodeText = IsClipboardFormatAvailable(CF_UNICODETEXT);
+
+		for (UINT format = EnumClipboardFormats(0); format != 0; format = EnumClipboardFormats(format))
+		{
+			if (!IsMemoryFormat(format) || (hasUnicodeText && (format == CF_TEXT || format == CF_OEMTEXT)))
+			{
+				continue;
+			}
+
+			HANDLE handle = GetClipboardData(format);
+			if (!handle)
+			{
+				continue;
+			}
+
+			SIZE_T size = GlobalSize(handle);
+			LPVOID data = size > 0 ? GlobalLock(handle) : nullptr;
+			if (data)
+			{
+				memcpy(Previous.Reserve(format, size), data, size);
+				GlobalUnlock(handle);
+			}
+		}
+
+		return !Previous.IsEmpty();
+	}
+
+	void SetText(const wchar_t* aText) override
+	{
+		SetData(CF_UNICODETEXT, aText, (wcslen(aText) + 1) * sizeof(wchar_t));
+	}
+
+	void Restore() override
+	{
+		EmptyClipboard();
+		for (const CClipboardSnapshot::Entry& entry : Previous.Formats())
+		{
+			PutData(entry.Format, Previous.Data(entry), entry.Size);
+		}
+	}
+
+private:
+	/* GDI handles and owner drawn formats are not memory blocks, their bytes cannot be copied */
+	static bool IsMemoryFormat(UINT aFormat)
+	{
+		switch (aFormat)
+		{
+		case CF_BITMAP:
+		case CF_METAFILEPICT:
+		case CF_PALETTE:
+		case CF_ENHMETAFILE:
+		case CF_OWNERDISPLAY:
+		case CF_DSPBITMAP:
+		case CF_DSPMETAFILEPICT:
+		case CF_DSPENHMETAFILE:
+			return false;
+		}
+		return aFormat < CF_GDIOBJFIRST || aFormat > CF_GDIOBJLAST;
+	}
+
+	void SetData(UINT aFormat, const void* aData, size_t aSize)
+	{
+		EmptyClipboard();
+		PutData(aFormat, aData, aSize);
+	}
+
+	void PutData(UINT aFormat, const void* aData, size_t aSize)
+	{
+		HGLOBAL hMem = GlobalAlloc(GMEM_MOVEABLE, aSize);
+		if (hMem)
+		{
+			LPVOID memLock = GlobalLock(hMem);
+			if (memLock)
+			{
+				memcpy(memLock, aData, aSize);
+				GlobalUnlock(hMem);
+				if (SetClipboardData(aFormat, hMem))
+				{
+					return;
+				}
+			}
+			GlobalFree(hMem);
+		}
+	}
+
+	CClipboardSnapshot Previous;
+};
+
+class CMumbleGameState : public IGameState
+{
+public:
+	bool IsTextboxFocused() override
+	{
+		return MumbleState.Read().Context.IsTextboxFocused;
+	}
+
+	bool IsInInstance() override
+	{
+		return MumbleState.Read().Context.MapType == Mumble::EMapType::Instance;
+	}
+
+	unsigned TextboxOpenings() override
+	{
+		return MumbleState.Read().TextboxOpenings;
+	}
+
+	bool WaitNextFrame(long long aDeadline) override
+	{
+		unsigned tick = Frames.Current();
+		return Frames.WaitNext(tick, std::chrono::steady_clock::time_point(std::chrono::microseconds(aDeadline)), &GGCancel);
+	}
+};
+
+class CSteadyClock : public IClock
+{
+public:
+	long long Now() override
+	{
+		return TriggerTimestamp();
+	}
+
+	void SleepUntil(long long aTime) override
+	{
+		std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::microseconds(aTime)));
+	}
+};
+
+CSendInputBackend InputBackend;
+CWindowMessageBackend MessageBackend;
+CInputSwitch Input;
+CWin32Clipboard ClipboardBackend;
+CMumbleGameState GameState;
+CSteadyClock SteadyClock;
+CGGPipeline Pipeline{ Input, ClipboardBackend, GameState, SteadyClock, &GGCancel };
+
+class CAddonWorkerHost : public IWorkerHost
+{
+public:
+	void Online() override
+	{
+		Config.Online(EConfigReader_Worker);
+	}
+
+	void Offline() override
+	{
+		Config.Offline(EConfigReader_Worker);
+	}
+
+	void Started() override
+	{
+		LoadDeferred();
+	}
+
+	void Woken() override
+	{
+		if (RenderRegistrationDirty.exchange(false))
+		{
+			UpdateRenderRegistration();
+		}
+	}
+
+	size_t Drain(Trigger* aBatch, size_t aSize) override
+	{
+		return DrainQueue(aBatch, aSize);
+	}
 
-std::mutex GGMutex;
-std::thread GGThread;
-bool IsGGThreadRunning = false;
-bool DoGG = false;
+	void Send(const Trigger* aTriggers, size_t aCount) override
+	{
+		SendGG(aTriggers, aCount);
+	}
+};
+CAddonWorkerHost WorkerHost;
+CGGWorker Worker{ WorkerHost, Pipeline, GGSignal, Frames, GGCancel };
+
+CTraceRecorder TraceRecorder;
 
 BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserved)
 {
@@ -253,103 +667,292 @@ extern "C" __declspec(dllexport) AddonDefinition* GetAddonDef()
 	return &AddonDef;
 }
 
+const char* GetScancodeName(unsigned short aScanCode)
+{
+	/* GetKeyNameText uses the layout of the calling thread, which is what the table is built for */
+	return ScancodeNames.Get(GetKeyboardLayout(0), aScanCode, [](unsigned short aCode, char* aBuffer, int aSize)
+	{
+		return GetKeyNameTextA(static_cast<LONG>(EncodeKeystroke(KeystrokeFlags{ 0, aCode, false, false, false })), aBuffer, aSize);
+	});
+}
+
+/* config colours are 0xRRGGBBAA */
+ImVec4 UnpackColor(unsigned aColor)
+{
+	return ImVec4(((aColor >> 24) & 0xFF) / 255.f, ((aColor >> 16) & 0xFF) / 255.f, ((aColor >> 8) & 0xFF) / 255.f, (aColor & 0xFF) / 255.f);
+}
+
+unsigned PackColor(const ImVec4& aColor)
+{
+	auto channel = [](float aValue) { return static_cast<unsigned>((aValue < 0.f ? 0.f : aValue > 1.f ? 1.f : aValue) * 255.f + 0.5f); };
+	return (channel(aColor.x) << 24) | (channel(aColor.y) << 16) | (channel(aColor.z) << 8) | channel(aColor.w);
+}
+
+/* Times the stages of a load step and logs them as one line once done. */
+struct StartupReport
+{
+	const char*	Name;
+	long long	Start = TriggerTimestamp();
+	long long	Last = Start;
+	std::string	Stages;
+
+	void Stage(const char* aStage)
+	{
+		long long now = TriggerTimestamp();
+		char buff[64];
+		snprintf(buff, sizeof(buff), "%s%s %.3f ms", Stages.empty() ? "" : ", ", aStage, (now - Last) / 1000.0);
+		Stages.append(buff);
+		Last = now;
+	}
+
+	void Log()
+	{
+		char buff[64];
+		snprintf(buff, sizeof(buff), "%s took %.3f ms (", Name, (Last - Start) / 1000.0);
+		APIDefs->Log(ELogLevel_INFO, "SlashGG", (buff + Stages + ")").c_str());
+	}
+};
+
 void AddonLoad(AddonAPI* aApi)
 {
 	APIDefs = aApi;
 	ImGui::SetCurrentContext((ImGuiContext*)APIDefs->ImguiContext);
 	ImGui::SetAllocatorFunctions((void* (*)(size_t, void*))APIDefs->ImguiMalloc, (void(*)(void*, void*))APIDefs->ImguiFree); // on imgui 1.80+
 
+	StartupReport report{ "Load" };
+
+	/* only what is needed before the first frame happens here, the rest is done by the worker in LoadDeferred() */
 	NexusLink = (NexusLinkData*)APIDefs->GetResource("DL_NEXUS_LINK");
 	MumbleLink = (Mumble::Data*)APIDefs->GetResource("DL_MUMBLE_LINK");
+	report.Stage("datalink");
 
-	APIDefs->RegisterRender(ERenderType_Render, AddonRender);
+	Config.Online(EConfigReader_Render);
+	APIDefs->RegisterRender(ERenderType_PreRender, AddonPreRender);
 	APIDefs->RegisterRender(ERenderType_OptionsRender, AddonOptions);
+	report.Stage("renders");
 
-	for (long long i = 0; i < 255; i++)
-	{
-		KeyLParam key{};
-		key.ScanCode = i;
-		char* buff = new char[64];
-		std::string str;
-		GetKeyNameTextA(static_cast<LONG>(KMFToLParam(key)), buff, 64);
-		str.append(buff);
+	TexturesRequested = TriggerTimestamp();
+	TexturesRequestedFrame = FrameCount;
+	APIDefs->LoadTextureFromResource("ICON_SUDOKU", ICON_SUDOKU, hSelf, ReceiveTexture);
+	report.Stage("textures");
+
+	APIDefs->RegisterKeybindWithString("KB_SUDOKU", ProcessKeybind, "CTRL+K");
+	APIDefs->RegisterWndProc(AddonWndProc);
+	KeyboardLayout = GetKeyboardLayout(0);
+	report.Stage("input");
 
-		ScancodeLookupTable[key.GetScanCode()] = str;
+	Worker.Start();
+	report.Stage("worker");
+
+	report.Log();
+}
+void AddonUnload()
+{
+	StartupReport report{ "Unload" };
 
-		key.ExtendedFlag = 1;
-		buff = new char[64];
-		str = "";
-		GetKeyNameTextA(static_cast<LONG>(KMFToLParam(key)), buff, 64);
-		str.append(buff);
+	APIDefs->DeregisterRender(AddonOptions);
+	APIDefs->DeregisterRender(AddonPreRender);
+	APIDefs->DeregisterWndProc(AddonWndProc);
+	Config.Offline(EConfigReader_Render);
+	report.Stage("callbacks");
 
-		ScancodeLookupTable[key.GetScanCode()] = str;
+	Worker.Stop();
+	report.Stage("worker");
 
-		delete[] buff;
+	/* only after the worker is gone, it is the one registering it */
+	if (IsRenderRegistered.exchange(false))
+	{
+		APIDefs->DeregisterRender(AddonRender);
 	}
 
-	APIDefs->RegisterKeybindWithString("KB_SUDOKU", ProcessKeybind, "CTRL+K");
+	/* triggers that were not sent anymore must not fire on the next load */
+	Trigger dropped[64];
+	while (DrainQueue(dropped, ARRAYSIZE(dropped)) > 0) {}
+
+	/* the render callbacks and the worker were the only readers and all of them are gone, nothing can see the datalinks anymore */
+	MumbleLink = nullptr;
+	NexusLink = nullptr;
+
+	SettingsWriter.Stop();
+	Config.Reclaim();
+	TraceRecorder.Stop();
+
+	ScancodeNames.Clear();
+	report.Stage("cleanup");
+
+	report.Log();
+}
+
+void LoadDeferred()
+{
+	StartupReport report{ "Deferred load" };
 
 	AddonPath = APIDefs->GetAddonDirectory("SlashGG");
 	SettingsPath = APIDefs->GetAddonDirectory("SlashGG/settings.json");
 	std::filesystem::create_directory(AddonPath);
+	report.Stage("directory");
+
 	LoadSettings(SettingsPath);
+	GGQueue.CoalesceWindowMs = Config.Get()->CoalesceWindowMs;
+	SettingsWriter.Start([] { SaveSettings(SettingsPath); });
+	IsSettingsLoaded = true;
+	report.Stage("settings");
+
+	CompiledPhrases.Revision = Config.Revision();
+	const AddonConfig* config = Config.Get();
+	CompilePhraseTable(CompiledPhrases, config, Win32Keys{ KeyboardLayout });
+	for (int i = 1; i < config->PhraseCount; i++)
+	{
+		APIDefs->RegisterKeybindWithString(KeybindNames[i], ProcessKeybind, "(null)");
+	}
+	report.Stage("phrases");
 
-	IsGGThreadRunning = true;
-	GGThread = std::thread(PerformSudoku);
-	GGThread.detach();
+	UpdateRenderRegistration();
+	report.Stage("render");
+
+	report.Log();
 }
-void AddonUnload()
+
+void ProcessKeybind(const char* aIdentifier)
 {
-	APIDefs->DeregisterRender(AddonOptions);
-	APIDefs->DeregisterRender(AddonRender);
+	int phrase = Keybinds.Find(HashIdentifier(aIdentifier));
+	if (phrase >= 0 && GGQueue.Push(ETriggerSource::Keybind, phrase))
+	{
+		GGSignal.Notify();
+	}
+}
 
-	MumbleLink = nullptr;
-	NexusLink = nullptr;
+UINT AddonWndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+	if (Game.load(std::memory_order_relaxed) != hWnd)
+	{
+		Game.store(hWnd, std::memory_order_relaxed);
+	}
+
+	if (uMsg == WM_INPUTLANGCHANGE)
+	{
+		/* the key sequences are rebuilt by the worker right before the next GG */
+		KeyboardLayout = (HKL)lParam;
+		LayoutChanged = true;
+	}
 
-	// this ends the thread, I'm too lazy to implement proper logic right now
-	IsGGThreadRunning = false;
-	DoGG = true;
-	std::lock_guard<std::mutex> lock(GGMutex);
+	return uMsg;
 }
 
-void ProcessKeybind(const char* aIdentifier)
+void AddonPreRender()
 {
-	if (strcmp(aIdentifier, "KB_SUDOKU") == 0)
+	/* the first callback of a frame, the render thread keeps no config from the last one */
+	Config.Quiescent(EConfigReader_Render);
+	FrameCount.fetch_add(1, std::memory_order_relaxed);
+
+	if (!IsRenderRegistered.load(std::memory_order_relaxed))
 	{
-		DoGG = true;
-		return;
+		SkippedRenderFrames++;
+	}
+
+	MumbleSnapshot snapshot{};
+	if (MumbleLink && ReadVersioned(MumbleLink->UITick, MumbleLink->Context, snapshot.Context, snapshot.Tick, 3, TornMumbleReads))
+	{
+		if (snapshot.Context.IsTextboxFocused && !WasTextboxFocused)
+		{
+			TextboxOpenings++;
+		}
+		WasTextboxFocused = snapshot.Context.IsTextboxFocused;
+		snapshot.TextboxOpenings = TextboxOpenings;
+
+		/* publish the state before the tick so a woken worker already sees the new frame */
+		MumbleState.Publish(snapshot);
+		Frames.Publish(snapshot.Tick);
+
+		/* the worker decides from the published snapshot, so it is asked once that has the new map type */
+		if (static_cast<int>(snapshot.Context.MapType) != PublishedMapType)
+		{
+			PublishedMapType = static_cast<int>(snapshot.Context.MapType);
+			RequestRenderRegistration();
+		}
+
+		/* the clipboard restore is waiting for the chat box to close */
+		if (Pipeline.IsRestorePending() && !snapshot.Context.IsTextboxFocused)
+		{
+			GGSignal.Notify();
+		}
+
+		if (TraceRecorder.IsRecording())
+		{
+			const Mumble::Context& ctx = snapshot.Context;
+			uint8_t flags =
+				(ctx.IsMapOpen ? ETraceFlags_IsMapOpen : 0) |
+				(ctx.IsGameFocused ? ETraceFlags_IsGameFocused : 0) |
+				(ctx.IsTextboxFocused ? ETraceFlags_IsTextboxFocused : 0) |
+				(ctx.IsInCombat ? ETraceFlags_IsInCombat : 0) |
+				(ctx.MapType == Mumble::EMapType::Instance ? ETraceFlags_IsInstance : 0);
+
+			TraceRecorder.Record(TraceRecord{ snapshot.Tick, TriggerTimestamp(), ctx.MapID, static_cast<uint8_t>(ctx.MapType), flags });
+		}
 	}
 }
 
 void AddonRender()
 {
-	if (!NexusLink || !NexusLink->IsGameplay || !MumbleLink || MumbleLink->Context.IsMapOpen || !IsSlashGGButtonVisible || (MumbleLink->Context.MapType != Mumble::EMapType::Instance))
+	/* settings, visibility, the map type and a missing NexusLink are covered by only being registered while they allow the button,
+	 * what is left changes too often for that. the map type is kept for the frames until the worker deregisters. */
+	if (!NexusLink->IsGameplay)
+	{
+		return;
+	}
+
+	MumbleSnapshot mumble = MumbleState.Read();
+	if (mumble.Context.IsMapOpen || mumble.Context.MapType != Mumble::EMapType::Instance)
 	{
 		return;
 	}
 
 	if (ImGui::Begin("Sudoku!", (bool*)0, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoBackground | ImGuiExt::UpdatePosition("Sudoku!")))
 	{
-		if (!Button || !ButtonHover)
-		{
-			Button = APIDefs->GetTextureOrCreateFromResource("ICON_SUDOKU", ICON_SUDOKU, hSelf);
-			ButtonHover = APIDefs->GetTextureOrCreateFromResource("ICON_SUDOKU_HOVER", ICON_SUDOKU_HOVER, hSelf);
-		}
-		else
+		if (AreTexturesReady.load(std::memory_order_acquire))
 		{
+			const AddonConfig* config = Config.Get();
+			ImVec4 tint = IsSlashGGButtonPressed ? UnpackColor(config->PressedTint) : IsSlashGGButtonHovered ? UnpackColor(config->HoverTint) : ImVec4(1.f, 1.f, 1.f, 1.f);
+			ImVec4 background = IsSlashGGButtonPressed || IsSlashGGButtonHovered ? UnpackColor(config->HighlightBackground) : ImVec4(0.f, 0.f, 0.f, 0.f);
+
 			ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.f, 0.f, 0.f, 0.f));
 			ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.f, 0.f, 0.f, 0.f));
 			ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.f, 0.f, 0.f, 0.f));
 			ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, { 0.f, 0.f });
 			ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, { 0.f, 0.f });
 
-			if (ImGui::ImageButton(IsSlashGGButtonHovered ? ButtonHover->Resource : Button->Resource, ImVec2(40.0f * NexusLink->Scaling, 40.0f * NexusLink->Scaling)))
+			float size = 40.0f * NexusLink->Scaling;
+			if (ImGui::ImageButton(Button.load(std::memory_order_relaxed)->Resource, ImVec2(size, size), ImVec2(0.f, 0.f), ImVec2(1.f, 1.f), -1, background, tint))
 			{
-				DoGG = true;
+				if (GGQueue.Push(ETriggerSource::Button, 0))
+				{
+					GGSignal.Notify();
+				}
 			}
 			IsSlashGGButtonHovered = ImGui::IsItemHovered();
+			IsSlashGGButtonPressed = ImGui::IsItemActive();
 			ImGui::PopStyleColor(3);
 			ImGui::PopStyleVar(2);
+
+			/* the rest of the palette as a strip of text buttons next to the icon */
+			for (int i = 1; i < config->PhraseCount; i++)
+			{
+				if (config->Phrases[i][0] == '\0')
+				{
+					continue;
+				}
+
+				ImGui::SameLine();
+				ImGui::PushID(i);
+				if (ImGui::Button(config->Phrases[i], ImVec2(0.f, size)))
+				{
+					if (GGQueue.Push(ETriggerSource::Button, i))
+					{
+						GGSignal.Notify();
+					}
+				}
+				ImGui::PopID();
+			}
 		}
 	}
 	ImGuiExt::ContextMenuPosition("SlashGGCtxMenu");
@@ -358,186 +961,373 @@ void AddonRender()
 }
 void AddonOptions()
 {
-	if (ImGui::Checkbox("Visible##BTN_SUDOKU_VISIBLE", &IsSlashGGButtonVisible))
+	if (!IsSettingsLoaded)
 	{
-		SaveSettings(SettingsPath);
+		ImGui::TextDisabled("Loading...");
+		return;
 	}
 
-	if (ImGui::Checkbox("Restore Clipboard##BTN_SUDOKU_RESTORE", &RestoreClipboard))
-	{
-		SaveSettings(SettingsPath);
-	}
-	if (ImGui::IsItemHovered())
+	const AddonConfig* config = Config.Get();
+
+	bool visible = config->IsVisible;
+	if (ImGui::Checkbox("Visible##BTN_SUDOKU_VISIBLE", &visible))
 	{
-		ImGui::BeginTooltip();
-		ImGui::Text("Resets the clipboard to its previous content after pasting /gg.");
-		ImGui::EndTooltip();
+		Config.Update([visible](AddonConfig& aConfig) { aConfig.IsVisible = visible; });
+		SettingsWriter.Schedule();
+		RequestRenderRegistration();
 	}
 
-	ImGui::Text("The GG button will only show in instances e.g. Fractals, Raids, Strikes.");
-	ImGui::Text("You can right-click the GG button to edit its position.");
-}
-
-void PerformSudoku()
-{
-	std::lock_guard<std::mutex> lock(GGMutex);
-	for (;;)
+	if (ImGui::CollapsingHeader("Phrases##SUDOKU_PHRASES", ImGuiTreeNodeFlags_DefaultOpen))
 	{
-		while (!DoGG)
+		for (int i = 0; i < config->PhraseCount; i++)
 		{
-			Sleep(1);
-		}
+			ImGui::PushID(i);
 
-		if (!IsGGThreadRunning)
-		{
-			break;
-		}
+			char* phrase = PhraseDrafts[i];
+			if (!IsPhraseDrafted[i])
+			{
+				memcpy(phrase, config->Phrases[i], PHRASE_LENGTH);
+			}
+			ImGui::SetNextItemWidth(200.0f);
+			if (ImGui::InputText("##SUDOKU_PHRASE", phrase, PHRASE_LENGTH))
+			{
+				IsPhraseDrafted[i] = true;
+			}
+			if (IsPhraseDrafted[i] && ImGui::IsItemDeactivatedAfterEdit())
+			{
+				Config.Update([i, phrase](AddonConfig& aConfig) { memcpy(aConfig.Phrases[i], phrase, PHRASE_LENGTH); });
+				SettingsWriter.Schedule();
+				IsPhraseDrafted[i] = false;
+			}
 
-		if (!MumbleLink->Context.IsTextboxFocused && MumbleLink->Context.MapType == Mumble::EMapType::Instance)
-		{
-			std::string cbPrevious;
-			size_t lenPrevious = 0;
-			char source[4] = "/gg";
-			HGLOBAL hMem = GlobalAlloc(GMEM_MOVEABLE, 4);
-			if (hMem)
+			/* the first phrase is the icon, it always stays */
+			if (i > 0)
 			{
-				LPVOID memLock = GlobalLock(hMem);
-				if (memLock)
+				ImGui::SameLine();
+				if (ImGui::Button("Remove##SUDOKU_PHRASE_REMOVE"))
 				{
-					memcpy(memLock, source, 4);
-					GlobalUnlock(hMem);
-					if (OpenClipboard(Game))
+					/* keybinds belong to slots, the last slot goes away */
+					Config.Update([i](AddonConfig& aConfig)
 					{
-						HANDLE cbHandleOld = GetClipboardData(CF_TEXT);
-						if (cbHandleOld)
+						for (int j = i; j + 1 < aConfig.PhraseCount; j++)
 						{
-							LPVOID memLockOld = GlobalLock(cbHandleOld);
-							if (memLockOld)
-							{
-								cbPrevious = (char*)memLockOld;
-								lenPrevious = cbPrevious.size() + 1;
-								GlobalUnlock(cbHandleOld);
-							}
+							memcpy(aConfig.Phrases[j], aConfig.Phrases[j + 1], PHRASE_LENGTH);
 						}
-						EmptyClipboard();
-						SetClipboardData(CF_TEXT, hMem);
-						CloseClipboard();
-					}
+						aConfig.PhraseCount--;
+						aConfig.Phrases[aConfig.PhraseCount][0] = '\0';
+					});
+					APIDefs->DeregisterKeybind(KeybindNames[config->PhraseCount - 1]);
+					SettingsWriter.Schedule();
+					config = Config.Get();
+
+					/* a field being edited was let go before the click, anything left belongs to the old positions */
+					memset(IsPhraseDrafted, 0, sizeof(IsPhraseDrafted));
 				}
 			}
 
-			INPUT retPress[1] = {};
-			INPUT retRelease[1] = {};
-
-			retPress[0].type = INPUT_KEYBOARD;
-			retPress[0].ki.wScan = MapVirtualKey(VK_RETURN, MAPVK_VK_TO_VSC);
-			retPress[0].ki.wVk = VK_RETURN;
+			ImGui::PopID();
+		}
 
-			retRelease[0].type = INPUT_KEYBOARD;
-			retRelease[0].ki.wScan = MapVirtualKey(VK_RETURN, MAPVK_VK_TO_VSC);
-			retRelease[0].ki.wVk = VK_RETURN;
-			retRelease[0].ki.dwFlags = KEYEVENTF_KEYUP;
+		if (config->PhraseCount < static_cast<int>(MAX_PHRASES) && ImGui::Button("Add phrase##SUDOKU_PHRASE_ADD"))
+		{
+			int slot = config->PhraseCount;
+			Config.Update([slot](AddonConfig& aConfig)
+			{
+				aConfig.Phrases[slot][0] = '\0';
+				aConfig.PhraseCount = slot + 1;
+			});
+			APIDefs->RegisterKeybindWithString(KeybindNames[slot], ProcessKeybind, "(null)");
+			SettingsWriter.Schedule();
+			config = Config.Get();
+		}
+		ImGui::TextDisabled("Keybinds follow the position in this list, the first one is KB_SUDOKU.");
+	}
 
-			INPUT lctrlPress[1] = {};
-			INPUT lctrlRelease[1] = {};
+	ImGui::Text("Send phrases by:");
+	int mode = static_cast<int>(config->InjectionMode);
+	bool modeChanged = ImGui::RadioButton("Pasting from the clipboard##SUDOKU_MODE_CLIPBOARD", &mode, static_cast<int>(EInjectionMode::Clipboard));
+	ImGui::SameLine();
+	modeChanged |= ImGui::RadioButton("Typing it##SUDOKU_MODE_UNICODE", &mode, static_cast<int>(EInjectionMode::Unicode));
+	if (ImGui::IsItemHovered())
+	{
+		ImGui::BeginTooltip();
+		ImGui::Text("Types the message directly into the chat box, does not touch the clipboard and skips the paste delay.");
+		ImGui::EndTooltip();
+	}
+	ImGui::SameLine();
+	modeChanged |= ImGui::RadioButton("Posting it to the game window##SUDOKU_MODE_MESSAGES", &mode, static_cast<int>(EInjectionMode::WindowMessages));
+	if (ImGui::IsItemHovered())
+	{
+		ImGui::BeginTooltip();
+		ImGui::Text("Sends the keys to the game window only, they cannot mix with what you are typing and no other window receives them.");
+		ImGui::EndTooltip();
+	}
+	if (modeChanged)
+	{
+		Config.Update([mode](AddonConfig& aConfig) { aConfig.InjectionMode = static_cast<EInjectionMode>(mode); });
+		SettingsWriter.Schedule();
+	}
 
-			lctrlPress[0].type = INPUT_KEYBOARD;
-			lctrlPress[0].ki.wScan = MapVirtualKey(VK_LCONTROL, MAPVK_VK_TO_VSC);
-			lctrlPress[0].ki.wVk = VK_LCONTROL;
+	bool restoreClipboard = config->RestoreClipboard;
+	if (ImGui::Checkbox("Restore Clipboard##BTN_SUDOKU_RESTORE", &restoreClipboard))
+	{
+		Config.Update([restoreClipboard](AddonConfig& aConfig) { aConfig.RestoreClipboard = restoreClipboard; });
+		SettingsWriter.Schedule();
+	}
+	if (ImGui::IsItemHovered())
+	{
+		ImGui::BeginTooltip();
+		ImGui::Text("Resets the clipboard to its previous content after pasting.");
+		ImGui::EndTooltip();
+	}
 
-			lctrlRelease[0].type = INPUT_KEYBOARD;
-			lctrlRelease[0].ki.wScan = MapVirtualKey(VK_LCONTROL, MAPVK_VK_TO_VSC);
-			lctrlRelease[0].ki.wVk = VK_LCONTROL;
-			lctrlRelease[0].ki.dwFlags = KEYEVENTF_KEYUP;
+	ImGui::SetNextItemWidth(200.0f);
+	int coalesceWindowMs = config->CoalesceWindowMs;
+	if (ImGui::SliderInt("Ignore repeated presses (ms)##SUDOKU_COALESCE", &coalesceWindowMs, 0, MAX_COALESCE_WINDOW_MS))
+	{
+		Config.Update([coalesceWindowMs](AddonConfig& aConfig) { aConfig.CoalesceWindowMs = coalesceWindowMs; });
+		GGQueue.CoalesceWindowMs = coalesceWindowMs;
+		SettingsWriter.Schedule();
+	}
+	if (ImGui::IsItemHovered())
+	{
+		ImGui::BeginTooltip();
+		ImGui::Text("Presses within this time of the last accepted one are merged into it. 0 sends every press.");
+		ImGui::Text("The default of 50 ms only catches a bouncing key or a double click, presses you mean are further apart.");
+		ImGui::EndTooltip();
+	}
+	ImGui::TextDisabled("Queued: %llu, merged: %llu, dropped: %llu", GGQueue.Enqueued.load(), GGQueue.Coalesced.load(), GGQueue.Dropped.load());
 
-			INPUT vPress[1] = {};
-			INPUT vRelease[1] = {};
+	if (ImGui::CollapsingHeader("Button style##SUDOKU_STYLE"))
+	{
+		struct { const char* Label; unsigned AddonConfig::* Color; } colors[] = {
+			{ "Hover tint##SUDOKU_HOVER_TINT", &AddonConfig::HoverTint },
+			{ "Pressed tint##SUDOKU_PRESSED_TINT", &AddonConfig::PressedTint },
+			{ "Highlight background##SUDOKU_HIGHLIGHT_BG", &AddonConfig::HighlightBackground }
+		};
 
-			vPress[0].type = INPUT_KEYBOARD;
-			vPress[0].ki.wScan = MapVirtualKey('V', MAPVK_VK_TO_VSC);
-			vPress[0].ki.wVk = 'V';
+		for (size_t i = 0; i < ARRAYSIZE(colors); i++)
+		{
+			ImVec4& value = ColorDrafts[i];
+			if (!IsColorDrafted[i])
+			{
+				value = UnpackColor(config->*colors[i].Color);
+			}
+			if (ImGui::ColorEdit4(colors[i].Label, &value.x, ImGuiColorEditFlags_NoInputs | ImGuiColorEditFlags_AlphaBar))
+			{
+				IsColorDrafted[i] = true;
+			}
 
-			vRelease[0].type = INPUT_KEYBOARD;
-			vRelease[0].ki.wScan = MapVirtualKey('V', MAPVK_VK_TO_VSC);
-			vRelease[0].ki.wVk = 'V';
-			vRelease[0].ki.dwFlags = KEYEVENTF_KEYUP;
+			/* the picker is a popup, IsItemActive() follows its drag but the deactivation is not always reported on the colour button */
+			if (IsColorDrafted[i] && (ImGui::IsItemDeactivatedAfterEdit() || !ImGui::IsItemActive()))
+			{
+				unsigned packed = PackColor(value);
+				unsigned AddonConfig::* member = colors[i].Color;
+				Config.Update([packed, member](AddonConfig& aConfig) { aConfig.*member = packed; });
+				SettingsWriter.Schedule();
+				IsColorDrafted[i] = false;
+			}
+		}
+	}
 
-			/* return stroke  */
-			SendInput(ARRAYSIZE(retPress), retPress, sizeof(INPUT));
-			SendInput(ARRAYSIZE(retRelease), retRelease, sizeof(INPUT));
+	if (ImGui::CollapsingHeader("Latency##SUDOKU_LATENCY"))
+	{
+		ImGui::TextDisabled("Sent: %llu, skipped: %llu, failed: %llu", Pipeline.Sent.load(), Pipeline.Skipped.load(), Pipeline.Failed.load());
+		ImGui::TextDisabled("Chat sessions: %llu, p50 %.1f ms, p99 %.1f ms", Pipeline.Batches.load(), Pipeline.BatchDuration.Percentile(0.50) / 1000.0, Pipeline.BatchDuration.Percentile(0.99) / 1000.0);
+		ImGui::TextDisabled("Clipboard opens: %llu, retried: %llu, contended: %llu, failed: %llu, wait p99 %.1f ms", Pipeline.ClipboardAttempts.load(), Pipeline.ClipboardRetries.load(), Pipeline.ClipboardContended.load(), Pipeline.ClipboardFailures.load(), Pipeline.ClipboardWait.Percentile(0.99) / 1000.0);
+		ImGui::TextDisabled("MumbleLink reads retried: %llu", TornMumbleReads);
+		ImGui::TextDisabled("Frames without the button callback: %llu", SkippedRenderFrames);
+		long long texturesReadyAfter = TexturesReadyAfter.load();
+		if (texturesReadyAfter >= 0)
+		{
+			ImGui::TextDisabled("Button drawable after %llu frames, %.3f ms", TexturesReadyAfterFrames.load(), texturesReadyAfter / 1000.0);
+		}
+		else
+		{
+			ImGui::TextDisabled("Button textures loading for %llu frames", FrameCount.load() - TexturesRequestedFrame);
+		}
 
-			int wait = 0;
-			while (!MumbleLink->Context.IsTextboxFocused)
+		if (ImGui::BeginTable("##SUDOKU_LATENCY_TABLE", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit))
+		{
+			ImGui::TableSetupColumn("Stage");
+			ImGui::TableSetupColumn("Samples");
+			ImGui::TableSetupColumn("p50 (ms)");
+			ImGui::TableSetupColumn("p95 (ms)");
+			ImGui::TableSetupColumn("p99 (ms)");
+			ImGui::TableHeadersRow();
+
+			for (int i = 0; i < static_cast<int>(EStage::COUNT); i++)
 			{
-				Sleep(1);
-				wait++;
+				CHistogram& hist = Pipeline.StageLatency[i];
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::Text(StageNames[i]);
+				ImGui::TableNextColumn(); ImGui::Text("%llu", hist.Count());
+				ImGui::TableNextColumn(); ImGui::Text("%.2f", hist.Percentile(0.50) / 1000.0);
+				ImGui::TableNextColumn(); ImGui::Text("%.2f", hist.Percentile(0.95) / 1000.0);
+				ImGui::TableNextColumn(); ImGui::Text("%.2f", hist.Percentile(0.99) / 1000.0);
+			}
 
-				if (wait >= 50)
-				{
-					break;
-				}
+			ImGui::EndTable();
+		}
+
+		if (ImGui::Button("Save to file##SUDOKU_LATENCY_DUMP"))
+		{
+			DumpLatency(AddonPath / "latency.txt");
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Reset##SUDOKU_LATENCY_RESET"))
+		{
+			for (CHistogram& hist : Pipeline.StageLatency)
+			{
+				hist.Reset();
 			}
+			Pipeline.BatchDuration.Reset();
+			Pipeline.ClipboardWait.Reset();
+		}
 
-			/* continue loop */
-			if (wait < 50)
+		bool isRecording = TraceRecorder.IsRecording();
+		if (ImGui::Checkbox("Record MumbleLink trace##SUDOKU_TRACE", &isRecording))
+		{
+			if (isRecording)
 			{
-				/* lctrl press */
-				SendInput(ARRAYSIZE(lctrlPress), lctrlPress, sizeof(INPUT));
+				TraceRecorder.Start(AddonPath / "mumble.trace");
+			}
+			else
+			{
+				TraceRecorder.Stop();
+			}
+		}
+		if (ImGui::IsItemHovered())
+		{
+			ImGui::BeginTooltip();
+			ImGui::Text("Writes the chat and map state of every frame to mumble.trace, to replay timing changes against real play.");
+			ImGui::EndTooltip();
+		}
+		if (TraceRecorder.IsRecording())
+		{
+			ImGui::SameLine();
+			ImGui::TextDisabled("%llu frames", TraceRecorder.Count());
+		}
+	}
 
-				/* v stroke */
-				SendInput(ARRAYSIZE(vPress), vPress, sizeof(INPUT));
-				SendInput(ARRAYSIZE(vRelease), vRelease, sizeof(INPUT));
+	ImGui::Text("The GG button will only show in instances e.g. Fractals, Raids, Strikes.");
+	ImGui::Text("You can right-click the GG button to edit its position.");
+}
 
-				Sleep(50);
+void ReceiveTexture(const char* aIdentifier, Texture* aTexture)
+{
+	if (!aTexture)
+	{
+		APIDefs->Log(ELogLevel_WARNING, "SlashGG", (std::string("Failed to load texture ") + aIdentifier).c_str());
+		return;
+	}
 
-				/* lctrl release */
-				SendInput(ARRAYSIZE(lctrlRelease), lctrlRelease, sizeof(INPUT));
+	if (strcmp(aIdentifier, "ICON_SUDOKU") == 0 && !AreTexturesReady)
+	{
+		Button = aTexture;
+		AreTexturesReady.store(true, std::memory_order_release);
 
-				/* return stroke  */
-				SendInput(ARRAYSIZE(retPress), retPress, sizeof(INPUT));
-				SendInput(ARRAYSIZE(retRelease), retRelease, sizeof(INPUT));
-			}
+		long long after = TriggerTimestamp() - TexturesRequested;
+		TexturesReadyAfterFrames = FrameCount - TexturesRequestedFrame;
+		TexturesReadyAfter = after;
 
-			if (RestoreClipboard)
-			{
-				wait = 0; /* wait for x ms */
-				int delay = 50; /* wait at least 50 ms initially. */
-				do
-				{
-					Sleep(delay);
-					delay = 1;
-					wait++;
+		char buff[96];
+		snprintf(buff, sizeof(buff), "Button drawable after %llu frames, %.3f ms", TexturesReadyAfterFrames.load(), after / 1000.0);
+		APIDefs->Log(ELogLevel_INFO, "SlashGG", buff);
+	}
+}
 
-					if (wait >= 250)
-					{
-						break;
-					}
-				} while (MumbleLink->Context.IsTextboxFocused);
+void RequestRenderRegistration()
+{
+	/* (de)registering from inside a render or event callback would reenter Nexus, so the worker does it */
+	RenderRegistrationDirty = true;
+	GGSignal.Notify();
+}
 
-				if (!cbPrevious.empty())
-				{
-					HGLOBAL hMem = GlobalAlloc(GMEM_MOVEABLE, lenPrevious);
-					if (hMem)
-					{
-						LPVOID memLock = GlobalLock(hMem);
-						if (memLock)
-						{
-							memcpy(memLock, cbPrevious.c_str(), lenPrevious - 1);
-							GlobalUnlock(hMem);
-							if (OpenClipboard(Game))
-							{
-								EmptyClipboard();
-								SetClipboardData(CF_TEXT, hMem);
-								CloseClipboard();
-							}
-						}
-					}
-				}
-			}
-		}
+void UpdateRenderRegistration()
+{
+	/* AddonRender dereferences NexusLink every frame, without it the button never shows */
+	MumbleSnapshot mumble = MumbleState.Read();
+	bool canShow = NexusLink && IsSettingsLoaded && Config.Get()->IsVisible && mumble.Context.MapType == Mumble::EMapType::Instance;
+	if (canShow == IsRenderRegistered)
+	{
+		return;
+	}
+
+	if (canShow)
+	{
+		APIDefs->RegisterRender(ERenderType_Render, AddonRender);
+	}
+	else
+	{
+		APIDefs->DeregisterRender(AddonRender);
+	}
+	IsRenderRegistered = canShow;
+}
+
+size_t DrainQueue(Trigger* aBatch, size_t aSize)
+{
+	size_t count = 0;
+	while (count < aSize && GGQueue.Pop(aBatch[count]))
+	{
+		count++;
+	}
+	return count;
+}
+
+void SendGG(const Trigger* aTriggers, size_t aCount)
+{
+	/* one consistent view of the settings for the whole sequence, the phrases are compiled from the same one */
+	/* compared by revision, a freed snapshot's address may come back for a newer one */
+	uint64_t revision = Config.Revision();
+	const AddonConfig* config = Config.Get();
+	if (LayoutChanged.exchange(false) || revision != CompiledPhrases.Revision)
+	{
+		CompilePhraseTable(CompiledPhrases, config, Win32Keys{ KeyboardLayout });
+		CompiledPhrases.Revision = revision;
+	}
+
+	Input.Active = config->InjectionMode == EInjectionMode::WindowMessages ? static_cast<IInput*>(&MessageBackend) : &InputBackend;
+	Pipeline.Run(aTriggers, aCount, *config);
+}
+
+void PostKeyMessages(const InputRun& aRun)
+{
+	HWND game = Game.load(std::memory_order_relaxed);
+	if (!game)
+	{
+		return;
+	}
 
-		DoGG = false;
+	for (size_t i = aRun.Offset; i < aRun.Offset + aRun.Count; i++)
+	{
+		const KeyMessage& message = CompiledPhrases.Messages[i];
+		PostMessageW(game, message.Message, message.WParam, message.LParam);
+	}
+}
+
+void SendKeySequence(const InputRun& aRun)
+{
+	SendInput(static_cast<UINT>(aRun.Count), &CompiledPhrases.Inputs[aRun.Offset], sizeof(INPUT));
+}
+
+void DumpLatency(std::filesystem::path aPath)
+{
+	std::ofstream file(aPath);
+	file << "stage\tsamples\tp50_us\tp95_us\tp99_us" << std::endl;
+	for (int i = 0; i < static_cast<int>(EStage::COUNT); i++)
+	{
+		CHistogram& hist = Pipeline.StageLatency[i];
+		file << StageNames[i] << '\t' << hist.Count() << '\t' << hist.Percentile(0.50) << '\t' << hist.Percentile(0.95) << '\t' << hist.Percentile(0.99) << std::endl;
 	}
+	CHistogram& batch = Pipeline.BatchDuration;
+	file << "Chat session" << '\t' << batch.Count() << '\t' << batch.Percentile(0.50) << '\t' << batch.Percentile(0.95) << '\t' << batch.Percentile(0.99) << std::endl;
+	CHistogram& clipboard = Pipeline.ClipboardWait;
+	file << "Clipboard contention" << '\t' << clipboard.Count() << '\t' << clipboard.Percentile(0.50) << '\t' << clipboard.Percentile(0.95) << '\t' << clipboard.Percentile(0.99) << std::endl;
+	file << "# clipboard opens " << Pipeline.ClipboardAttempts << ", retried " << Pipeline.ClipboardRetries << ", contended " << Pipeline.ClipboardContended << ", failed " << Pipeline.ClipboardFailures << std::endl;
+	file.close();
+
+	APIDefs->Log(ELogLevel_INFO, "SlashGG", ("Latency written to " + aPath.string()).c_str());
 }
 
 void LoadSettings(std::filesystem::path aPath)
@@ -547,38 +1337,55 @@ void LoadSettings(std::filesystem::path aPath)
 		return;
 	}
 
+	AddonConfig config = *Config.Get();
+	std::string error;
+	bool success;
+
 	Mutex.lock();
 	{
-		try
-		{
-			std::ifstream file(aPath);
-			Settings = json::parse(file);
-			file.close();
-		}
-		catch (json::parse_error& ex)
-		{
-			APIDefs->Log(ELogLevel_WARNING, "Restore Honor", "Settings.json could not be parsed.");
-			APIDefs->Log(ELogLevel_WARNING, "Restore Honor", ex.what());
-		}
+		std::ifstream file(aPath);
+		success = ReadSettings(file, config, error);
+		file.close();
 	}
 	Mutex.unlock();
 
-	if (!Settings.is_null())
+	if (!success)
 	{
-		if (!Settings["IsVisible"].is_null()) { Settings["IsVisible"].get_to(IsSlashGGButtonVisible); }
-		if (!Settings["RestoreClipboard"].is_null()) { Settings["RestoreClipboard"].get_to(RestoreClipboard); }
+		APIDefs->Log(ELogLevel_WARNING, "SlashGG", "Settings.json could not be parsed.");
+		APIDefs->Log(ELogLevel_WARNING, "SlashGG", error.c_str());
+		return;
 	}
+
+	Config.Update([&config](AddonConfig& aConfig) { aConfig = config; });
 }
 void SaveSettings(std::filesystem::path aPath)
 {
-	Settings["IsVisible"] = IsSlashGGButtonVisible;
-	Settings["RestoreClipboard"] = RestoreClipboard;
-
+	Config.Online(EConfigReader_Writer);
 	Mutex.lock();
 	{
-		std::ofstream file(aPath);
-		file << Settings.dump(1, '\t') << std::endl;
+		/* write next to the target and swap it in, a crash mid-write never leaves a truncated settings.json behind */
+		std::filesystem::path tmpPath = aPath;
+		tmpPath += ".tmp";
+
+		std::ofstream file(tmpPath);
+		bool isWritten = WriteSettings(file, *Config.Get());
 		file.close();
+
+		std::error_code ec;
+		if (!isWritten)
+		{
+			std::filesystem::remove(tmpPath, ec);
+			APIDefs->Log(ELogLevel_WARNING, "SlashGG", "Settings.json is from a newer version of SlashGG, changes are kept for this session only.");
+		}
+		else
+		{
+			std::filesystem::rename(tmpPath, aPath, ec);
+			if (ec)
+			{
+				APIDefs->Log(ELogLevel_WARNING, "SlashGG", "Settings.json could not be written.");
+			}
+		}
 	}
 	Mutex.unlock();
-}
\ No newline at end of file
+	Config.Offline(EConfigReader_Writer);
+}
@@ -3,7 +3,6 @@
 // Used by GW2-SlashGG.rc
 //
 #define ICON_SUDOKU               101
-#define ICON_SUDOKU_HOVER         102
 
 // Next default values for new objects
 // 
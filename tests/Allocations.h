@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+/* Counts every allocation of the executable and the bytes it holds by replacing the global operator new.
+ * Include in exactly one translation unit per executable. */
+inline std::atomic<unsigned long long>& Allocations()
+{
+	static std::atomic<unsigned long long> count{ 0 };
+	return count;
+}
+
+/* bytes currently allocated */
+inline std::atomic<long long>& AllocatedBytes()
+{
+	static std::atomic<long long> bytes{ 0 };
+	return bytes;
+}
+
+/* highest AllocatedBytes() since the last ResetPeakBytes() */
+inline std::atomic<long long>& PeakBytes()
+{
+	static std::atomic<long long> bytes{ 0 };
+	return bytes;
+}
+
+inline void ResetPeakBytes()
+{
+	PeakBytes() = AllocatedBytes().load();
+}
+
+namespace AllocationsDetail
+{
+	/* every block starts with its size, padded to keep the alignment of new */
+	constexpr std::size_t HEADER = alignof(std::max_align_t);
+
+	/* kept out of line, inlined into a delete the compiler warns about the header arithmetic and about free() on a pointer from new */
+#if defined(_MSC_VER)
+	__declspec(noinline)
+#else
+	__attribute__((noinline))
+#endif
+	inline void Release(void* aMemory)
+	{
+		if (!aMemory)
+		{
+			return;
+		}
+
+		char* block = static_cast<char*>(aMemory) - HEADER;
+		AllocatedBytes().fetch_sub(static_cast<long long>(*reinterpret_cast<std::size_t*>(block)), std::memory_order_relaxed);
+		std::free(block);
+	}
+}
+
+void* operator new(std::size_t aSize)
+{
+	Allocations().fetch_add(1, std::memory_order_relaxed);
+	if (char* block = static_cast<char*>(std::malloc(aSize + AllocationsDetail::HEADER)))
+	{
+		*reinterpret_cast<std::size_t*>(block) = aSize;
+		long long bytes = AllocatedBytes().fetch_add(static_cast<long long>(aSize), std::memory_order_relaxed) + static_cast<long long>(aSize);
+		long long peak = PeakBytes().load(std::memory_order_relaxed);
+		while (bytes > peak && !PeakBytes().compare_exchange_weak(peak, bytes, std::memory_order_relaxed)) {}
+		return block + AllocationsDetail::HEADER;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t aSize)
+{
+	return operator new(aSize);
+}
+
+void operator delete(void* aMemory) noexcept
+{
+	AllocationsDetail::Release(aMemory);
+}
+
+void operator delete[](void* aMemory) noexcept
+{
+	AllocationsDetail::Release(aMemory);
+}
+
+void operator delete(void* aMemory, std::size_t) noexcept
+{
+	AllocationsDetail::Release(aMemory);
+}
+
+void operator delete[](void* aMemory, std::size_t) noexcept
+{
+	AllocationsDetail::Release(aMemory);
+}
@@ -0,0 +1,282 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Check.h"
+#include "KeyMessages.h"
+#include "PhraseTable.h"
+
+/* The two ways a typed GG reaches the game: SendInput() records into the system input queue, which the user's own keystrokes go through as well,
+ * against WM_KEYDOWN/WM_CHAR/WM_KEYUP posted to the game window's queue with lParams from KeyMessages.h.
+ * Both sinks append under a lock like the kernel does per call, their cost does not exist here, so ns is only the in-process part plus that lock.
+ * PostMessage() takes one message per call, so the posted GG makes more calls than the two SendInput() calls.
+ * While a thread types into the input queue, counts the GGs whose keys it got in between: SendInput() keeps one call together,
+ * but the Return that opens the chat and the text are two calls with the wait for the chat in between. Every posted lParam is decoded and checked.
+ *
+ * usage: backendbench [--count N] */
+
+namespace
+{
+	const unsigned WM_KEYDOWN_ = 0x100;
+	const unsigned WM_KEYUP_ = 0x101;
+	const unsigned WM_CHAR_ = 0x102;
+	const unsigned short RETURN_SCAN = 0x1C;
+	const unsigned short USER = 0xFFFF; /* marks a key the user typed */
+
+	struct FakeInput
+	{
+		unsigned short	Vk;
+		unsigned short	Scan;
+		unsigned		Flags;
+	};
+
+	struct FakeMessage
+	{
+		unsigned	Message;
+		unsigned	WParam;
+		uint32_t	LParam;
+	};
+
+	/* stands in for the system input queue and SendInput() */
+	struct InputQueue
+	{
+		std::mutex				Mutex;
+		std::vector<FakeInput>	Inputs;
+		unsigned long long		Calls = 0;
+
+		void Send(unsigned aCount, const FakeInput* aInputs)
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			Calls++;
+			Inputs.insert(Inputs.end(), aInputs, aInputs + aCount);
+		}
+	};
+
+	/* stands in for the game window's posted message queue and PostMessage() */
+	struct MessageQueue
+	{
+		std::mutex					Mutex;
+		std::vector<FakeMessage>	Messages;
+		unsigned long long			Calls = 0;
+
+		void Post(unsigned aMessage, unsigned aWParam, uint32_t aLParam)
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			Calls++;
+			Messages.push_back(FakeMessage{ aMessage, aWParam, aLParam });
+		}
+	};
+
+	/* the same records as Win32Keys in entry.cpp, with a fixed layout */
+	struct FakeKeys
+	{
+		using Input = FakeInput;
+		using Message = FakeMessage;
+
+		static unsigned short VirtualKey(EKey aKey)
+		{
+			switch (aKey)
+			{
+			case EKey::Return:	return 0x0D;
+			case EKey::Control:	return 0xA2;
+			case EKey::V:		return 'V';
+			}
+			return 0;
+		}
+
+		static unsigned short ScanCode(EKey aKey)
+		{
+			switch (aKey)
+			{
+			case EKey::Return:	return RETURN_SCAN;
+			case EKey::Control:	return 0x1D;
+			case EKey::V:		return 0x2F;
+			}
+			return 0;
+		}
+
+		FakeInput Key(EKey aKey, bool aRelease) const
+		{
+			return FakeInput{ VirtualKey(aKey), ScanCode(aKey), aRelease ? 2u : 0u };
+		}
+
+		FakeInput Unicode(wchar_t aUnit, bool aRelease) const
+		{
+			return FakeInput{ 0, static_cast<unsigned short>(aUnit), aRelease ? 6u : 4u };
+		}
+
+		void AppendKeyMessages(std::vector<FakeMessage>& aMessages, EKey aKey) const
+		{
+			aMessages.push_back(FakeMessage{ WM_KEYDOWN_, VirtualKey(aKey), KeyDownLParam(ScanCode(aKey)) });
+			aMessages.push_back(FakeMessage{ WM_KEYUP_, VirtualKey(aKey), KeyUpLParam(ScanCode(aKey)) });
+		}
+
+		FakeMessage Char(wchar_t aUnit) const
+		{
+			return FakeMessage{ WM_CHAR_, static_cast<unsigned>(aUnit), KeyDownLParam(0) };
+		}
+	};
+
+	using Table = BasicPhraseTable<FakeKeys>;
+
+	void SendKeySequence(InputQueue& aQueue, const Table& aTable, const InputRun& aRun)
+	{
+		aQueue.Send(static_cast<unsigned>(aRun.Count), &aTable.Inputs[aRun.Offset]);
+	}
+
+	void PostKeyMessages(MessageQueue& aQueue, const Table& aTable, const InputRun& aRun)
+	{
+		for (size_t i = aRun.Offset; i < aRun.Offset + aRun.Count; i++)
+		{
+			const FakeMessage& message = aTable.Messages[i];
+			aQueue.Post(message.Message, message.WParam, message.LParam);
+		}
+	}
+
+	/* a typed GG: the Return, the wait for the chat, the text with its Return */
+	template<typename TSend>
+	void TypedGG(TSend aSend, const Table& aTable, unsigned aPhrase, bool aWait)
+	{
+		aSend(aTable, true, aPhrase);
+		if (aWait)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+		}
+		aSend(aTable, false, aPhrase);
+	}
+
+	/* GGs with a user key between their first and last record, each GG starts at the Return that opens the chat */
+	unsigned long long Interleaved(const std::vector<FakeInput>& aInputs, size_t aPerGG)
+	{
+		unsigned long long interleaved = 0;
+		size_t ours = 0;
+		bool isMixed = false;
+		for (const FakeInput& input : aInputs)
+		{
+			if (input.Scan == USER)
+			{
+				isMixed |= ours > 0;
+				continue;
+			}
+			if (++ours == aPerGG)
+			{
+				interleaved += isMixed ? 1 : 0;
+				ours = 0;
+				isMixed = false;
+			}
+		}
+		return interleaved;
+	}
+
+	/* every message decodes back to the key it was built from */
+	bool IsWellFormed(const std::vector<FakeMessage>& aMessages, const std::vector<wchar_t>& aText)
+	{
+		size_t unit = 0;
+		for (const FakeMessage& message : aMessages)
+		{
+			KeystrokeFlags flags = DecodeKeystroke(message.LParam);
+			if (flags.RepeatCount != 1 || flags.ContextCode)
+			{
+				return false;
+			}
+
+			switch (message.Message)
+			{
+			case WM_KEYDOWN_:
+				if (message.WParam != 0x0D || flags.ScanCode != RETURN_SCAN || flags.PreviousKeyState || flags.TransitionState) { return false; }
+				break;
+			case WM_KEYUP_:
+				if (message.WParam != 0x0D || flags.ScanCode != RETURN_SCAN || !flags.PreviousKeyState || !flags.TransitionState) { return false; }
+				unit = 0;
+				break;
+			case WM_CHAR_:
+				if (unit >= aText.size() || message.WParam != static_cast<unsigned>(aText[unit++]) || flags.TransitionState) { return false; }
+				break;
+			default:
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned count = 100000;
+	if (argc == 3 && strcmp(argv[1], "--count") == 0)
+	{
+		count = static_cast<unsigned>(atoi(argv[2]));
+	}
+
+	AddonConfig config;
+	config.PhraseCount = 1;
+	snprintf(config.Phrases[0], PHRASE_LENGTH, "gg wp \xE2\x9D\xA4");
+
+	Table table{};
+	CompilePhraseTable(table, &config, FakeKeys{});
+	const wchar_t* phrase = &table.Text[table.TextOffset[0]];
+	std::vector<wchar_t> text(phrase, phrase + wcslen(phrase));
+
+	InputQueue inputs;
+	MessageQueue messages;
+	auto sendInput = [&](const Table& aTable, bool aOpen, unsigned aPhrase) { SendKeySequence(inputs, aTable, aOpen ? aTable.Open : aTable.TypeSubmit[aPhrase]); };
+	auto postMessages = [&](const Table& aTable, bool aOpen, unsigned aPhrase) { PostKeyMessages(messages, aTable, aOpen ? aTable.OpenMessages : aTable.TypeSubmitMessages[aPhrase]); };
+
+	printf("%u typed GGs of %zu UTF-16 units\n", count, text.size());
+	printf("%-12s %10s %12s %12s\n", "", "ns/GG", "calls/GG", "records/GG");
+
+	auto run = [&](const char* aName, auto aSend, unsigned long long& aCalls, auto aRecords)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (unsigned i = 0; i < count; i++)
+		{
+			TypedGG(aSend, table, 0, false);
+		}
+		double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+		printf("%-12s %10.1f %12.2f %12.2f\n", aName, ns, static_cast<double>(aCalls) / count, static_cast<double>(aRecords()) / count);
+	};
+	run("SendInput", sendInput, inputs.Calls, [&] { return inputs.Inputs.size(); });
+	run("posted", postMessages, messages.Calls, [&] { return messages.Messages.size(); });
+
+	/* Return down and up, a down and up per unit, Return down and up, in two calls; the messages have a single WM_CHAR per unit */
+	CHECK(inputs.Calls == 2ull * count);
+	CHECK(inputs.Inputs.size() == (4 + 2 * text.size()) * count);
+	CHECK(messages.Messages.size() == (4 + text.size()) * count);
+	CHECK(messages.Calls == messages.Messages.size());
+	CHECK(IsWellFormed(messages.Messages, text));
+
+	/* the user types while GGs go out, the Return and the text are apart by the wait for the chat */
+	unsigned typed = count < 200 ? count : 200;
+	inputs.Inputs.clear();
+	messages.Messages.clear();
+	std::atomic<bool> isTyping{ true };
+	std::thread user([&]
+	{
+		FakeInput key{ 'A', USER, 0 };
+		while (isTyping.load())
+		{
+			inputs.Send(1, &key);
+			std::this_thread::sleep_for(std::chrono::microseconds(50));
+		}
+	});
+	for (unsigned i = 0; i < typed; i++)
+	{
+		TypedGG(sendInput, table, 0, true);
+		TypedGG(postMessages, table, 0, true);
+	}
+	isTyping = false;
+	user.join();
+
+	unsigned long long mixed = Interleaved(inputs.Inputs, 4 + 2 * text.size());
+	printf("while the user types: %llu of %u GGs through SendInput had user keys in between, 0 of %u posted, the user's keys never reach the posted queue\n", mixed, typed, typed);
+	CHECK(IsWellFormed(messages.Messages, text));
+	CHECK(messages.Messages.size() == (4 + text.size()) * typed);
+
+	return TestResult();
+}
@@ -0,0 +1,70 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Check.h"
+#include "Scenario.h"
+
+/* Cost of a burst of N quick triggers, sent in one chat session against one chat session per trigger as before batching,
+ * where each trigger waited for the previous chat to close and the clipboard to come back. Clipboard mode on the simulated game at 60 fps.
+ * The time to the last message of a burst is the end-to-end p99, the chat session the time of the whole burst.
+ *
+ * usage: batchbench [--count N] */
+
+int main(int argc, char** argv)
+{
+	unsigned count = 500;
+	if (argc == 3 && strcmp(argv[1], "--count") == 0)
+	{
+		count = static_cast<unsigned>(atoi(argv[2]));
+	}
+
+	const unsigned sizes[] = { 1, 2, 4, 8 };
+
+	printf("%u bursts per run, 3 s apart, chat shows open 1-3 frames after the Return\n", count);
+	printf("%-12s %5s %12s %12s %12s %10s %16s\n", "", "burst", "e2e_p50_ms", "e2e_p99_ms", "sessions", "restores", "clipboard_opens");
+
+	double single = 0;
+	for (unsigned size : sizes)
+	{
+		ScenarioResult results[2];
+		for (int batched = 0; batched < 2; batched++)
+		{
+			ScenarioOptions options;
+			options.Bursts = count;
+			options.BurstSize = size;
+			options.BurstInterval = 3000000;
+			options.IsBatched = batched != 0;
+
+			ScenarioResult& result = results[batched];
+			result = RunScenario(options);
+			printf("%-12s %5u %12.2f %12.2f %12llu %10llu %16llu\n", batched ? "batched" : "one by one", size,
+				result.EndToEnd.P50 / 1000.0, result.EndToEnd.P99 / 1000.0, result.Batch.Count,
+				result.Stages[static_cast<int>(EStage::ClipboardRestored)].Count, result.ClipboardOpens);
+
+			CHECK(result.SuccessRate() == 1.0);
+			CHECK(result.Wrong == 0);
+			CHECK(result.IsClipboardIntact);
+		}
+
+		const ScenarioResult& oneByOne = results[0];
+		const ScenarioResult& batched = results[1];
+
+		/* one session and one restore per burst, every message after the first only costs its own send */
+		CHECK(batched.Batch.Count == count);
+		CHECK(batched.Stages[static_cast<int>(EStage::ClipboardRestored)].Count == count);
+		CHECK(oneByOne.Batch.Count == static_cast<unsigned long long>(count) * size);
+		if (size == 1)
+		{
+			single = batched.EndToEnd.P99;
+		}
+		else
+		{
+			CHECK(batched.EndToEnd.P99 < oneByOne.EndToEnd.P99);
+			printf("%-12s %5u %12s %12.2f per message after the first, one by one %.2f\n", "", size, "",
+				(batched.EndToEnd.P99 - single) / 1000.0 / (size - 1), (oneByOne.EndToEnd.P99 - single) / 1000.0 / (size - 1));
+		}
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdio>
+
+/* Minimal assertions for the test executables: failures are printed and counted, main returns TestResult(). */
+inline int& TestFailures()
+{
+	static int failures = 0;
+	return failures;
+}
+
+#define CHECK(aCondition) \
+	do \
+	{ \
+		if (!(aCondition)) \
+		{ \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #aCondition); \
+			TestFailures()++; \
+		} \
+	} while (0)
+
+inline int TestResult()
+{
+	if (TestFailures() > 0)
+	{
+		fprintf(stderr, "%d checks failed\n", TestFailures());
+		return 1;
+	}
+	printf("all checks passed\n");
+	return 0;
+}
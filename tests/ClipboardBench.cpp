@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Allocations.h"
+#include "Check.h"
+#include "Fakes.h"
+
+/* Cost of saving and restoring the clipboard around a GG as it grows from a few bytes to tens of MB, the baseline copying CF_TEXT
+ * through a std::string up to the first NUL against CClipboardSnapshot copying every format once into its pooled buffer.
+ * Text is one CF_TEXT block both keep, an image one CF_DIB block full of zeros the baseline drops. Restoring writes into the fake clipboard,
+ * which allocates and copies like GlobalAlloc() and memcpy() into the handle do.
+ *
+ * usage: clipboardbench [--max-bytes N] */
+
+namespace
+{
+	constexpr unsigned FAKE_CF_TEXT = 1;
+	constexpr unsigned FAKE_CF_DIB = 8;
+
+	struct Content
+	{
+		const char*					Name;
+		unsigned					Format;
+		std::vector<unsigned char>	Bytes;
+	};
+
+	Content Text(size_t aSize)
+	{
+		Content content{ "text", FAKE_CF_TEXT, std::vector<unsigned char>(aSize) };
+		for (size_t i = 0; i + 1 < aSize; i++)
+		{
+			content.Bytes[i] = static_cast<unsigned char>('a' + i % 26);
+		}
+		content.Bytes[aSize - 1] = 0;
+		return content;
+	}
+
+	/* a header, then pixels of a mostly black picture */
+	Content Image(size_t aSize)
+	{
+		Content content{ "image", FAKE_CF_DIB, std::vector<unsigned char>(aSize) };
+		content.Bytes[0] = 40;
+		for (size_t i = 64; i < aSize; i += 61)
+		{
+			content.Bytes[i] = static_cast<unsigned char>(i);
+		}
+		return content;
+	}
+
+	struct Measured
+	{
+		double				SaveUs = 0;
+		double				RestoreUs = 0;
+		unsigned long long	SaveAllocations = 0;	/* of the last save, once the buffers are warm */
+		bool				IsIntact = false;
+	};
+
+	template<typename TSave, typename TRestore>
+	Measured Measure(unsigned aIterations, CFakeClipboard& aClipboard, const Content& aContent, TSave aSave, TRestore aRestore)
+	{
+		Measured measured;
+		std::chrono::steady_clock::duration save{};
+		std::chrono::steady_clock::duration restore{};
+		for (unsigned i = 0; i < aIterations; i++)
+		{
+			aClipboard.Formats.clear();
+			aClipboard.SetFormat(aContent.Format, aContent.Bytes.data(), aContent.Bytes.size());
+
+			unsigned long long allocations = Allocations();
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			aSave();
+			save += std::chrono::steady_clock::now() - start;
+			measured.SaveAllocations = Allocations() - allocations;
+
+			aClipboard.SetText(L"/gg");
+
+			start = std::chrono::steady_clock::now();
+			aRestore();
+			restore += std::chrono::steady_clock::now() - start;
+		}
+
+		measured.SaveUs = std::chrono::duration<double, std::micro>(save).count() / aIterations;
+		measured.RestoreUs = std::chrono::duration<double, std::micro>(restore).count() / aIterations;
+		measured.IsIntact = aClipboard.Formats.size() == 1 && aClipboard.Formats.count(aContent.Format) == 1 && aClipboard.Formats[aContent.Format] == aContent.Bytes;
+		return measured;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	size_t maxBytes = 32 * 1024 * 1024;
+	if (argc == 3 && strcmp(argv[1], "--max-bytes") == 0)
+	{
+		maxBytes = static_cast<size_t>(atoll(argv[2]));
+	}
+
+	CSystemClock clock;
+	printf("%-6s %10s %12s %12s %8s %12s %12s %8s %8s\n", "", "bytes", "base_save_us", "base_rest_us", "intact", "snap_save_us", "snap_rest_us", "allocs", "intact");
+
+	for (size_t size = 16; size <= maxBytes; size *= 8)
+	{
+		unsigned iterations = static_cast<unsigned>(std::min<size_t>(1000, std::max<size_t>(3, (64u << 20) / size)));
+		for (const Content& content : { Text(size), Image(size) })
+		{
+			CFakeClipboard clipboard{ clock };
+
+			/* what the addon did before: CF_TEXT only, read as a C string */
+			std::string previous;
+			Measured baseline = Measure(iterations, clipboard, content, [&]
+			{
+				previous.clear();
+				auto it = clipboard.Formats.find(FAKE_CF_TEXT);
+				if (it != clipboard.Formats.end())
+				{
+					previous = reinterpret_cast<const char*>(it->second.data());
+				}
+			},
+			[&]
+			{
+				if (!previous.empty())
+				{
+					clipboard.Formats.clear();
+					clipboard.SetFormat(FAKE_CF_TEXT, previous.c_str(), previous.size() + 1);
+				}
+			});
+
+			Measured snapshot = Measure(iterations, clipboard, content, [&] { clipboard.Save(); }, [&] { clipboard.Restore(); });
+
+			printf("%-6s %10zu %12.2f %12.2f %8s %12.2f %12.2f %8llu %8s\n", content.Name, size,
+				baseline.SaveUs, baseline.RestoreUs, baseline.IsIntact ? "yes" : "no",
+				snapshot.SaveUs, snapshot.RestoreUs, snapshot.SaveAllocations, snapshot.IsIntact ? "yes" : "no");
+
+			/* every format comes back byte for byte, and saving a clipboard no larger than the last one does not allocate */
+			CHECK(snapshot.IsIntact);
+			CHECK(snapshot.SaveAllocations == 0);
+			if (content.Format == FAKE_CF_TEXT)
+			{
+				CHECK(baseline.IsIntact);
+			}
+		}
+	}
+
+	return TestResult();
+}
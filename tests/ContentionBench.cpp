@@ -0,0 +1,71 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Check.h"
+#include "Scenario.h"
+
+/* Clipboard acquisition while another process holds the clipboard for a while before every GG, from a few ms to past the deadline.
+ * The baseline opened the clipboard once and pasted whatever was on it when that failed. Now the pipeline retries with exponential backoff
+ * until CLIPBOARD_OPEN_TIMEOUT and fails the GG past it. Prints the retries per GG and the time spent waiting for the clipboard,
+ * as the upper bounds of the histogram buckets the diagnostics show.
+ *
+ * usage: contentionbench [--count N] */
+
+int main(int argc, char** argv)
+{
+	unsigned count = 500;
+	if (argc == 3 && strcmp(argv[1], "--count") == 0)
+	{
+		count = static_cast<unsigned>(atoi(argv[2]));
+	}
+
+	const long long holds[] = { 0, 1000, 5000, 10000, 30000, 60000, 90000, 150000, 500000 };
+	const long long deadline = std::chrono::duration_cast<std::chrono::microseconds>(CLIPBOARD_OPEN_TIMEOUT).count();
+
+	printf("%u GGs per row, 3 s apart, clipboard mode, giving up after %lld ms\n", count, deadline / 1000);
+	printf("%10s %10s %10s %12s %12s %10s %10s\n", "held_ms", "success", "retries", "wait_p50_ms", "wait_p99_ms", "failures", "wrong");
+
+	for (long long hold : holds)
+	{
+		ScenarioOptions options;
+		options.Bursts = count;
+		options.BurstInterval = 3000000;
+		options.Contention = hold;
+
+		ScenarioResult result = RunScenario(options);
+		printf("%10.1f %9.1f%% %10.2f %12.2f %12.2f %10llu %10llu\n", hold / 1000.0, result.SuccessRate() * 100.0,
+			static_cast<double>(result.ClipboardRetries) / count, result.ClipboardWait.P50 / 1000.0, result.ClipboardWait.P99 / 1000.0,
+			result.ClipboardFailures, result.Wrong);
+
+		/* never a message with someone else's clipboard, and what the user had comes back */
+		CHECK(result.Wrong == 0);
+		CHECK(result.IsClipboardIntact);
+
+		if (hold == 0)
+		{
+			CHECK(result.ClipboardRetries == 0);
+			CHECK(result.ClipboardWait.Count == 0);
+		}
+		else if (hold < deadline)
+		{
+			/* the backoff never oversleeps a hold by more than its longest step */
+			CHECK(result.SuccessRate() == 1.0);
+			CHECK(result.ClipboardFailures == 0);
+			CHECK(result.ClipboardWait.Count == count);
+			CHECK(result.ClipboardWait.P50 >= static_cast<unsigned long long>(hold) / 2);
+		}
+		else
+		{
+			/* every GG gives up at the deadline instead of waiting the hold out */
+			CHECK(result.SuccessRate() == 0.0);
+			CHECK(result.ClipboardFailures == count);
+			CHECK(result.Failed == count);
+			CHECK(result.ClipboardWait.P99 >= static_cast<unsigned long long>(deadline) / 2);
+			CHECK(result.ClipboardWait.P99 < static_cast<unsigned long long>(deadline) * 2);
+		}
+	}
+
+	return TestResult();
+}
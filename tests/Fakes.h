@@ -0,0 +1,349 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ClipboardSnapshot.h"
+#include "Pipeline.h"
+
+constexpr unsigned FAKE_CF_UNICODETEXT = 13;
+
+/* Time only moves when somebody sleeps, every run with the same script gives the same numbers. */
+class CVirtualClock : public IClock
+{
+public:
+	long long Now() override
+	{
+		return Time;
+	}
+
+	void SleepUntil(long long aTime) override
+	{
+		if (aTime > Time)
+		{
+			Time = aTime;
+		}
+	}
+
+	long long Time = 0;
+};
+
+class CSystemClock : public IClock
+{
+public:
+	long long Now() override
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void SleepUntil(long long aTime) override
+	{
+		std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::microseconds(aTime)));
+	}
+};
+
+/* Clipboard of another process: a set of formats with their bytes, held by someone else until BusyUntil. */
+class CFakeClipboard : public IClipboard
+{
+public:
+	CFakeClipboard(IClock& aClock)
+		: Clock(aClock)
+	{
+	}
+
+	bool Open() override
+	{
+		Opens++;
+		if (IsOpen || Clock.Now() < BusyUntil)
+		{
+			return false;
+		}
+		IsOpen = true;
+		return true;
+	}
+
+	void Close() override
+	{
+		IsOpen = false;
+	}
+
+	bool Save() override
+	{
+		Saved.Clear();
+		for (const auto& format : Formats)
+		{
+			if (!format.second.empty())
+			{
+				memcpy(Saved.Reserve(format.first, format.second.size()), format.second.data(), format.second.size());
+			}
+		}
+		return !Saved.IsEmpty();
+	}
+
+	void SetText(const wchar_t* aText) override
+	{
+		Formats.clear();
+		SetFormat(FAKE_CF_UNICODETEXT, aText, (wcslen(aText) + 1) * sizeof(wchar_t));
+	}
+
+	void Restore() override
+	{
+		Formats.clear();
+		for (const CClipboardSnapshot::Entry& entry : Saved.Formats())
+		{
+			SetFormat(entry.Format, Saved.Data(entry), entry.Size);
+		}
+		Restores++;
+	}
+
+	void SetFormat(unsigned aFormat, const void* aData, size_t aSize)
+	{
+		const unsigned char* data = static_cast<const unsigned char*>(aData);
+		Formats[aFormat].assign(data, data + aSize);
+	}
+
+	std::wstring Text() const
+	{
+		auto it = Formats.find(FAKE_CF_UNICODETEXT);
+		if (it == Formats.end() || it->second.size() < sizeof(wchar_t))
+		{
+			return std::wstring();
+		}
+		return std::wstring(reinterpret_cast<const wchar_t*>(it->second.data()));
+	}
+
+	std::map<unsigned, std::vector<unsigned char>>	Formats;
+	long long										BusyUntil = 0;	/* clock time */
+	bool											IsOpen = false;
+	unsigned long long								Opens = 0;
+	unsigned long long								Restores = 0;
+
+private:
+	IClock&				Clock;
+	CClipboardSnapshot	Saved;
+};
+
+/* The game as the pipeline sees it through MumbleLink. Keys are processed in order on the first frame after they were sent,
+ * a Return opens the chat or submits it. MumbleLink shows the chat open FocusDelay frames after the Return was processed. */
+class CSimulatedGame : public IGameState
+{
+public:
+	struct Message
+	{
+		long long		Time;	/* clock time of the frame that submitted it */
+		std::wstring	Text;
+	};
+
+	CSimulatedGame(IClock& aClock, CFakeClipboard& aClipboard, long long aFramePeriod, uint32_t aSeed = 1)
+		: Clock(aClock), Clipboard(aClipboard), FramePeriod(aFramePeriod), Origin(aClock.Now()), Random(aSeed)
+	{
+	}
+
+	/* frames from processing the opening Return until MumbleLink shows the textbox focused, drawn per opening */
+	unsigned	FocusDelayMin = 1;
+	unsigned	FocusDelayMax = 3;
+	bool		InInstance = true;
+
+	std::vector<Message>	Messages;
+
+	void PressReturn(long long aTime) { Keys.push_back(Key{ aTime, EKey::Return, std::wstring() }); }
+	void PressPaste(long long aTime) { Keys.push_back(Key{ aTime, EKey::Paste, std::wstring() }); }
+	void TypeText(long long aTime, const std::wstring& aText) { Keys.push_back(Key{ aTime, EKey::Text, aText }); }
+
+	bool IsTextboxFocused() override
+	{
+		Update();
+		return Focused;
+	}
+
+	bool IsInInstance() override
+	{
+		return InInstance;
+	}
+
+	unsigned TextboxOpenings() override
+	{
+		Update();
+		return Openings;
+	}
+
+	bool WaitNextFrame(long long aDeadline) override
+	{
+		long long next = FrameAfter(Clock.Now());
+		if (next > aDeadline)
+		{
+			Clock.SleepUntil(aDeadline);
+			return false;
+		}
+
+		Clock.SleepUntil(next);
+		return true;
+	}
+
+	/* the draft in the chat box, what the next Return would submit */
+	const std::wstring& Draft()
+	{
+		Update();
+		return Text;
+	}
+
+	long long FrameAfter(long long aTime) const
+	{
+		long long frames = (aTime - Origin) / FramePeriod + 1;
+		return Origin + frames * FramePeriod;
+	}
+
+	long long Period() const
+	{
+		return FramePeriod;
+	}
+
+private:
+	enum class EKey
+	{
+		Return,
+		Paste,
+		Text
+	};
+
+	struct Key
+	{
+		long long		Time;
+		EKey			Type;
+		std::wstring	Text;
+	};
+
+	struct FocusChange
+	{
+		long long	Time;
+		bool		Focused;
+	};
+
+	void Update()
+	{
+		long long now = Clock.Now();
+
+		while (!Keys.empty())
+		{
+			long long frame = FrameAfter(Keys.front().Time);
+			if (frame > now)
+			{
+				break;
+			}
+
+			const Key& key = Keys.front();
+			switch (key.Type)
+			{
+			case EKey::Return:
+				if (IsChatOpen)
+				{
+					/* an empty chat box just closes */
+					if (!Text.empty())
+					{
+						Messages.push_back(Message{ frame, Text });
+					}
+					Text.clear();
+					IsChatOpen = false;
+					ShowFocus(frame, false);
+				}
+				else
+				{
+					IsChatOpen = true;
+					unsigned delay = std::uniform_int_distribution<unsigned>(FocusDelayMin, FocusDelayMax)(Random);
+					ShowFocus(frame + static_cast<long long>(delay > 0 ? delay - 1 : 0) * FramePeriod, true);
+				}
+				break;
+			case EKey::Paste:
+				if (IsChatOpen)
+				{
+					Text += Clipboard.Text();
+				}
+				break;
+			case EKey::Text:
+				if (IsChatOpen)
+				{
+					Text += key.Text;
+				}
+				break;
+			}
+			Keys.pop_front();
+		}
+
+		while (!Changes.empty() && Changes.front().Time <= now)
+		{
+			if (Changes.front().Focused && !Focused)
+			{
+				Openings++;
+			}
+			Focused = Changes.front().Focused;
+			Changes.pop_front();
+		}
+	}
+
+	void ShowFocus(long long aTime, bool aFocused)
+	{
+		/* a later state supersedes whatever was still about to show */
+		while (!Changes.empty() && Changes.back().Time >= aTime)
+		{
+			Changes.pop_back();
+		}
+		Changes.push_back(FocusChange{ aTime, aFocused });
+	}
+
+	IClock&					Clock;
+	CFakeClipboard&			Clipboard;
+	const long long			FramePeriod;
+	const long long			Origin;
+	std::mt19937			Random;
+
+	std::deque<Key>			Keys;
+	std::deque<FocusChange>	Changes;
+	bool					IsChatOpen = false;
+	bool					Focused = false;
+	unsigned				Openings = 0;
+	std::wstring			Text;
+};
+
+/* Turns the pipeline's key sequences into key presses on the simulated game, stamped with the clock. */
+class CFakeInput : public IInput
+{
+public:
+	CFakeInput(IClock& aClock, CSimulatedGame& aGame, std::vector<std::wstring> aPhrases)
+		: Clock(aClock), Game(aGame), Phrases(std::move(aPhrases))
+	{
+	}
+
+	void Send(EKeySequence aSequence, unsigned aPhrase) override
+	{
+		long long now = Clock.Now();
+		Calls[static_cast<int>(aSequence)]++;
+
+		switch (aSequence)
+		{
+		case EKeySequence::Open:		Game.PressReturn(now); break;
+		case EKeySequence::Paste:		Game.PressPaste(now); break;
+		case EKeySequence::PasteSubmit:	Game.PressReturn(now); break;
+		case EKeySequence::TypeSubmit:	Game.TypeText(now, Phrases[aPhrase]); Game.PressReturn(now); break;
+		case EKeySequence::PasteCancel:	break;
+		}
+	}
+
+	const wchar_t* Text(unsigned aPhrase) override
+	{
+		return Phrases[aPhrase].c_str();
+	}
+
+	unsigned long long	Calls[KEY_SEQUENCE_COUNT]{};
+
+private:
+	IClock&						Clock;
+	CSimulatedGame&				Game;
+	std::vector<std::wstring>	Phrases;
+};
@@ -0,0 +1,164 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "Cancellation.h"
+#include "Check.h"
+#include "FrameClock.h"
+#include "Histogram.h"
+
+/* Validates CFrameClock against a simulated MumbleLink producer: a thread that bumps uiTick once per frame and opens and closes the chat every few frames.
+ * A worker follows the chat state either by waiting for the next tick or by polling with Sleep(1) like the baseline,
+ * the benchmark reports its wakeups per second and how long after the frame it noticed each change.
+ * Also checks that a wait gives up at its deadline when no frame comes and returns at once when cancelled.
+ *
+ * usage: framebench [--seconds S] */
+
+namespace
+{
+	long long NowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/* what the game writes to MumbleLink, published once per frame */
+	struct Producer
+	{
+		std::atomic<unsigned>	Tick{ 0 };
+		std::atomic<bool>		IsTextboxFocused{ false };
+		std::atomic<long long>	ChangedAt{ 0 };	/* time of the frame that flipped IsTextboxFocused */
+		std::atomic<bool>		IsRunning{ true };
+		unsigned long long		Frames = 0;
+
+		void Run(double aFramesPerSecond, unsigned aFramesPerChange, CFrameClock* aClock)
+		{
+			std::chrono::nanoseconds period(static_cast<long long>(1e9 / aFramesPerSecond));
+			std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+
+			while (IsRunning.load())
+			{
+				next += period;
+				std::this_thread::sleep_until(next);
+				Frames++;
+
+				if (Frames % aFramesPerChange == 0)
+				{
+					ChangedAt.store(NowNs());
+					IsTextboxFocused.store(!IsTextboxFocused.load());
+				}
+				Tick.store(static_cast<unsigned>(Frames));
+				if (aClock)
+				{
+					aClock->Publish(static_cast<unsigned>(Frames));
+				}
+			}
+		}
+	};
+
+	struct Result
+	{
+		unsigned long long	Wakeups = 0;
+		unsigned long long	Changes = 0;
+		unsigned long long	Frames = 0;
+		CHistogram			Lag;	/* nanoseconds from the frame to noticing the change */
+	};
+
+	/* follows the chat state for aSeconds, with the frame clock or, without one, with 1 ms polling */
+	void Follow(Result& aResult, double aFramesPerSecond, double aSeconds, bool aUseClock)
+	{
+		Producer producer;
+		CFrameClock clock;
+		std::thread thread([&] { producer.Run(aFramesPerSecond, 5, aUseClock ? &clock : nullptr); });
+
+		bool seen = false;
+		unsigned tick = clock.Current();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(aSeconds));
+
+		while (std::chrono::steady_clock::now() < end)
+		{
+			if (aUseClock)
+			{
+				clock.WaitNext(tick, end);
+			}
+			else
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			aResult.Wakeups++;
+
+			bool focused = producer.IsTextboxFocused.load();
+			if (focused != seen)
+			{
+				seen = focused;
+				aResult.Changes++;
+				aResult.Lag.Record(static_cast<unsigned long long>(NowNs() - producer.ChangedAt.load()));
+			}
+		}
+
+		producer.IsRunning.store(false);
+		thread.join();
+		aResult.Frames = producer.Frames;
+	}
+
+	void Row(const char* aName, double aFramesPerSecond, double aSeconds, const Result& aResult)
+	{
+		printf("%-16s %5.0f %12.0f %14.2f %8llu %10.1f %10.1f %10.1f\n", aName, aFramesPerSecond, aResult.Wakeups / aSeconds,
+			aResult.Frames > 0 ? static_cast<double>(aResult.Wakeups) / aResult.Frames : 0.0, aResult.Changes,
+			aResult.Lag.Percentile(0.50) / 1000.0, aResult.Lag.Percentile(0.95) / 1000.0, aResult.Lag.Percentile(0.99) / 1000.0);
+	}
+
+	long long MsSince(std::chrono::steady_clock::time_point aStart)
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - aStart).count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	double seconds = 2.0;
+	if (argc == 3 && strcmp(argv[1], "--seconds") == 0)
+	{
+		seconds = atof(argv[2]);
+	}
+
+	printf("chat flips every 5 frames, %.1f s per run\n", seconds);
+	printf("%-16s %5s %12s %14s %8s %10s %10s %10s\n", "wait", "fps", "wakeups/s", "wakeups/frame", "changes", "lag_p50_us", "lag_p95_us", "lag_p99_us");
+
+	const double rates[] = { 60.0, 144.0, 240.0 };
+	for (double rate : rates)
+	{
+		Result polling, ticked;
+		Follow(polling, rate, seconds, false);
+		Follow(ticked, rate, seconds, true);
+		Row("Sleep(1) polling", rate, seconds, polling);
+		Row("CFrameClock", rate, seconds, ticked);
+
+		/* one wakeup per published frame, and none of the changes missed */
+		CHECK(ticked.Wakeups <= ticked.Frames + 1);
+		CHECK(ticked.Changes + 2 >= ticked.Frames / 5);
+	}
+
+	/* no producer: the wait ends at its deadline */
+	CFrameClock clock;
+	unsigned tick = clock.Current();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	CHECK(!clock.WaitNext(tick, start + std::chrono::milliseconds(20)));
+	long long waited = MsSince(start);
+	printf("wait without frames returned after %lld ms, deadline 20 ms\n", waited);
+	CHECK(waited >= 20 && waited < 200);
+
+	/* a cancelled wait returns long before its deadline */
+	CCancellation cancel;
+	start = std::chrono::steady_clock::now();
+	std::thread canceller([&] { std::this_thread::sleep_for(std::chrono::milliseconds(10)); cancel.Cancel(); clock.Wake(); });
+	CHECK(!clock.WaitNext(tick, start + std::chrono::seconds(10), &cancel));
+	canceller.join();
+	waited = MsSince(start);
+	printf("cancelled wait returned after %lld ms, deadline 10000 ms\n", waited);
+	CHECK(waited < 1000);
+
+	return TestResult();
+}
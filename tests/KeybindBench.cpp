@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include "Allocations.h"
+#include "Check.h"
+#include "KeyNames.h"
+
+/* Calls per second and allocations per call of KeybindToString() and ConvertToUTF8(), the baseline against CKeybindStrings and the buffer based conversion.
+ * The Win32 calls are fakes: the code page is Latin-1 and key names are formatted, so the rates are the in-process part.
+ * KeybindToString() has no caller in the addon, neither now nor in the baseline, this is what a keybind UI redrawn every frame would pay.
+ *
+ * usage: keybindbench [--calls N] */
+
+namespace
+{
+	struct Keybind
+	{
+		unsigned short	Key;
+		bool			Alt;
+		bool			Ctrl;
+		bool			Shift;
+	};
+
+	/* stands in for GetKeyNameTextA, the left Alt is called "Ä" to take the conversion off the ASCII path */
+	int GetKeyNameText(unsigned short aScanCode, char* aBuffer, int aSize)
+	{
+		if (aScanCode == 0x38)
+		{
+			return snprintf(aBuffer, static_cast<size_t>(aSize), "\xC4lt");
+		}
+		return snprintf(aBuffer, static_cast<size_t>(aSize), "Key %02X", aScanCode & 0xFF);
+	}
+
+	/* stands in for MultiByteToWideChar(CP_ACP) followed by WideCharToMultiByte(CP_UTF8), for Latin-1 */
+	size_t Latin1ToUTF8(const char* aText, char* aOut, size_t aSize)
+	{
+		size_t len = 0;
+		for (const unsigned char* c = reinterpret_cast<const unsigned char*>(aText); *c; c++)
+		{
+			size_t units = *c < 0x80 ? 1 : 2;
+			if (len + units >= aSize) { break; }
+			if (units == 1)
+			{
+				aOut[len++] = static_cast<char>(*c);
+			}
+			else
+			{
+				aOut[len++] = static_cast<char>(0xC0 | (*c >> 6));
+				aOut[len++] = static_cast<char>(0x80 | (*c & 0x3F));
+			}
+		}
+		aOut[len] = '\0';
+		return len;
+	}
+
+	/* the baseline conversion: two heap buffers, the result is returned as new[], which the baseline never freed */
+	const char* BaselineConvertToUTF8(const char* aMultibyte)
+	{
+		size_t wideCount = strlen(aMultibyte) + 1;
+		wchar_t* wide = new wchar_t[wideCount];
+		for (size_t i = 0; i < wideCount; i++)
+		{
+			wide[i] = static_cast<unsigned char>(aMultibyte[i]);
+		}
+
+		char* utf8 = new char[wideCount * 2];
+		Latin1ToUTF8(aMultibyte, utf8, wideCount * 2);
+		delete[] wide;
+		return utf8;
+	}
+
+	std::map<unsigned short, std::string> ScancodeLookupTable;
+
+	/* the baseline KeybindToString(), with the leaked conversion result freed so the benchmark can run under the address sanitizer */
+	std::string BaselineKeybindToString(const Keybind& aKeybind, bool aPadded)
+	{
+		char* buff = new char[100];
+		std::string str;
+
+		if (aKeybind.Alt)
+		{
+			GetKeyNameText(0x38, buff, 100);
+			str.append(buff);
+			str.append(aPadded ? " + " : "+");
+		}
+
+		if (aKeybind.Ctrl)
+		{
+			GetKeyNameText(0x1D, buff, 100);
+			str.append(buff);
+			str.append(aPadded ? " + " : "+");
+		}
+
+		if (aKeybind.Shift)
+		{
+			GetKeyNameText(0x2A, buff, 100);
+			str.append(buff);
+			str.append(aPadded ? " + " : "+");
+		}
+
+		auto it = ScancodeLookupTable.find(aKeybind.Key);
+		if (it != ScancodeLookupTable.end())
+		{
+			str.append(it->second);
+		}
+
+		delete[] buff;
+
+		std::transform(str.begin(), str.end(), str.begin(), ::toupper);
+
+		const char* utf8 = BaselineConvertToUTF8(str.c_str());
+		std::string result(utf8);
+		delete[] utf8;
+		return result;
+	}
+
+	CScancodeNames<int> ScancodeNames;
+	CKeybindStrings<Keybind, int> KeybindStrings;
+
+	const char* GetScancodeName(unsigned short aScanCode)
+	{
+		return ScancodeNames.Get(0, aScanCode, GetKeyNameText);
+	}
+
+	void Append(char* aBuffer, size_t aSize, const char* aText)
+	{
+		size_t len = strlen(aBuffer);
+		snprintf(aBuffer + len, aSize - len, "%s", aText);
+	}
+
+	/* KeybindToString() as in entry.cpp, with strcat_s spelled out */
+	const char* KeybindToString(const Keybind& aKeybind, bool aPadded, int aLayout = 0)
+	{
+		return KeybindStrings.Get(aKeybind, aPadded, aLayout, [&aKeybind, aPadded](char* aBuffer, size_t aSize)
+		{
+			char str[256]{};
+			const char* separator = aPadded ? " + " : "+";
+
+			if (aKeybind.Alt)	{ Append(str, sizeof(str), GetScancodeName(0x38)); Append(str, sizeof(str), separator); }
+			if (aKeybind.Ctrl)	{ Append(str, sizeof(str), GetScancodeName(0x1D)); Append(str, sizeof(str), separator); }
+			if (aKeybind.Shift)	{ Append(str, sizeof(str), GetScancodeName(0x2A)); Append(str, sizeof(str), separator); }
+			Append(str, sizeof(str), GetScancodeName(aKeybind.Key));
+
+			for (char* c = str; *c; c++)
+			{
+				*c = static_cast<char>(toupper(static_cast<unsigned char>(*c)));
+			}
+
+			return ConvertToUTF8(str, aBuffer, aSize, Latin1ToUTF8);
+		});
+	}
+
+	template<typename F>
+	void Measure(const char* aName, unsigned aCalls, F aCall, unsigned long long* aAllocations = nullptr)
+	{
+		unsigned long long allocations = Allocations();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (unsigned i = 0; i < aCalls; i++)
+		{
+			aCall(i);
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		unsigned long long allocated = Allocations() - allocations;
+
+		printf("%-40s %14.0f %16.2f\n", aName, aCalls / seconds, static_cast<double>(allocated) / aCalls);
+		if (aAllocations)
+		{
+			*aAllocations = allocated;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned calls = 1000000;
+	if (argc == 3 && strcmp(argv[1], "--calls") == 0)
+	{
+		calls = static_cast<unsigned>(atoi(argv[2]));
+	}
+
+	char buff[64];
+	for (unsigned short i = 0; i < 255; i++)
+	{
+		GetKeyNameText(i, buff, sizeof(buff));
+		ScancodeLookupTable[i] = buff;
+	}
+
+	/* what an options window shows every frame: the binds of the whole palette */
+	const Keybind binds[] = {
+		{ 0x25, false, true, false },	/* CTRL+K */
+		{ 0x22, true, false, true },	/* ÄLT+SHIFT+G */
+		{ 0x3B, false, false, false },	/* F1 */
+		{ 0x02, false, true, true }		/* CTRL+SHIFT+1 */
+	};
+	const size_t count = sizeof(binds) / sizeof(binds[0]);
+
+	printf("%-40s %14s %16s\n", "", "calls/s", "allocations/call");
+
+	size_t checksum = 0;
+	char utf8[64];
+	Measure("baseline ConvertToUTF8, ASCII", calls, [&](unsigned) { const char* s = BaselineConvertToUTF8("CTRL+K"); checksum += s[0]; delete[] s; });
+	unsigned long long asciiAllocations = 0;
+	Measure("ConvertToUTF8, ASCII", calls, [&](unsigned) { checksum += ConvertToUTF8("CTRL+K", utf8, sizeof(utf8), Latin1ToUTF8); }, &asciiAllocations);
+	Measure("baseline ConvertToUTF8, Latin-1", calls, [&](unsigned) { const char* s = BaselineConvertToUTF8("\xC4LT+G"); checksum += s[0]; delete[] s; });
+	unsigned long long latinAllocations = 0;
+	Measure("ConvertToUTF8, Latin-1", calls, [&](unsigned) { checksum += ConvertToUTF8("\xC4LT+G", utf8, sizeof(utf8), Latin1ToUTF8); }, &latinAllocations);
+
+	Measure("baseline KeybindToString", calls, [&](unsigned i) { checksum += BaselineKeybindToString(binds[i % count], true).size(); });
+	Measure("KeybindToString, first call per bind", static_cast<unsigned>(count), [&](unsigned i) { checksum += strlen(KeybindToString(binds[i], true)); });
+	unsigned long long cachedAllocations = 0;
+	Measure("KeybindToString, every frame after", calls, [&](unsigned i) { checksum += strlen(KeybindToString(binds[i % count], true)); }, &cachedAllocations);
+	printf("checksum %zu\n", checksum);
+
+	CHECK(asciiAllocations == 0);
+	CHECK(latinAllocations == 0);
+	CHECK(cachedAllocations == 0);
+	for (size_t i = 0; i < count; i++)
+	{
+		CHECK(BaselineKeybindToString(binds[i], true) == KeybindToString(binds[i], true));
+		CHECK(BaselineKeybindToString(binds[i], false) == KeybindToString(binds[i], false));
+	}
+	CHECK(strcmp(KeybindToString(binds[1], true), "\xC3\x84LT + KEY 2A + KEY 22") == 0);
+	CHECK(KeybindToString(binds[0], true) == KeybindToString(binds[0], true));
+	CHECK(KeybindToString(binds[0], true) != KeybindToString(binds[0], true, 1));
+
+	return TestResult();
+}
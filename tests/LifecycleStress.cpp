@@ -0,0 +1,366 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Cancellation.h"
+#include "Check.h"
+#include "Fakes.h"
+#include "FrameClock.h"
+#include "Histogram.h"
+#include "PhraseTable.h"
+#include "Pipeline.h"
+#include "SeqLock.h"
+#include "Settings.h"
+#include "Signal.h"
+#include "Snapshot.h"
+#include "TriggerQueue.h"
+#include "Worker.h"
+
+/* Starts and stops the addon's CGGWorker in a loop while triggers keep firing, the way AddonLoad() and AddonUnload() do:
+ * a render thread publishing frames and editing the settings, two threads firing triggers, the worker draining the queue into the pipeline.
+ * The shared game state lives in a block that is freed right after every unload, a worker still touching it is caught by the address sanitizer.
+ * The keys are the records of a compiled phrase table, after every unload no key may be left down and the user's clipboard has to be back.
+ * Prints how long the unloads took, which is bounded by one clipboard backoff step or key send, not by a whole GG.
+ *
+ * usage: lifecycle_stress [--cycles N] */
+
+namespace
+{
+	const long long FRAME_PERIOD = 2000; /* microseconds, a fast game keeps the cycles short */
+	/* Stop() waits out the clipboard backoff step or key send the worker is in, the keys here cost nothing, plus a few ms for the scheduler */
+	const std::chrono::microseconds UNLOAD_BOUND = CLIPBOARD_BACKOFF_MAX + std::chrono::milliseconds(4);
+
+	long long Now()
+	{
+		return TriggerTimestamp();
+	}
+
+	struct GameFrame
+	{
+		unsigned	Tick;
+		bool		IsTextboxFocused;
+		unsigned	TextboxOpenings;
+	};
+
+	/* stands in for MumbleLink and the game behind it: keys are processed on the next frame, a Return toggles the chat, the focus shows a frame later */
+	struct GameLink
+	{
+		std::mutex			Mutex;
+		unsigned			Returns = 0;	/* Return presses since the last frame */
+		bool				IsHeld[3]{};	/* per EKey */
+		bool				IsChatOpen = false;
+		unsigned			OpenedAt = 0;
+		unsigned long long	Messages = 0;
+	};
+
+	/* a key record as SendInput() would get it, text units are not held by anything */
+	struct KeyRecord
+	{
+		bool			IsUnicode;
+		EKey			Key;
+		bool			IsRelease;
+	};
+
+	struct StressKeys
+	{
+		using Input = KeyRecord;
+		using Message = KeyRecord;
+
+		KeyRecord Key(EKey aKey, bool aRelease) const { return KeyRecord{ false, aKey, aRelease }; }
+		KeyRecord Unicode(wchar_t, bool aRelease) const { return KeyRecord{ true, EKey::Return, aRelease }; }
+		void AppendKeyMessages(std::vector<KeyRecord>&, EKey) const {}
+		KeyRecord Char(wchar_t) const { return KeyRecord{ true, EKey::Return, false }; }
+	};
+
+	BasicPhraseTable<StressKeys> Phrases{};
+
+	enum EConfigReader
+	{
+		EConfigReader_Render,
+		EConfigReader_Worker,
+		EConfigReader_COUNT
+	};
+
+	/* what entry.cpp keeps in globals, alive for the whole process */
+	CSnapshot<AddonConfig, EConfigReader_COUNT> Config;
+	CSeqLock<GameFrame> GameState;
+	CFrameClock Frames;
+	CSignal GGSignal;
+	CTriggerQueue<64, MAX_PHRASES> GGQueue;
+	CCancellation GGCancel;
+
+	/* load scoped, like MumbleLink and the threads */
+	GameLink* Link = nullptr;
+	unsigned long long Submitted = 0; /* messages the game received, summed over the loads */
+	std::thread RenderThread;
+	std::atomic<bool> IsRendering{ false };
+
+	class CLinkInput : public IInput
+	{
+	public:
+		void Send(EKeySequence aSequence, unsigned aPhrase) override
+		{
+			InputRun run{};
+			switch (aSequence)
+			{
+			case EKeySequence::Open:		run = Phrases.Open; break;
+			case EKeySequence::Paste:		run = Phrases.Paste; break;
+			case EKeySequence::PasteSubmit:	run = Phrases.PasteSubmit; break;
+			case EKeySequence::TypeSubmit:	run = Phrases.TypeSubmit[aPhrase]; break;
+			case EKeySequence::PasteCancel:	run = Phrases.PasteCancel; break;
+			}
+
+			std::lock_guard<std::mutex> lock(Link->Mutex);
+			for (size_t i = run.Offset; i < run.Offset + run.Count; i++)
+			{
+				const KeyRecord& record = Phrases.Inputs[i];
+				if (record.IsUnicode)
+				{
+					continue;
+				}
+				Link->IsHeld[static_cast<int>(record.Key)] = !record.IsRelease;
+				if (record.Key == EKey::Return && !record.IsRelease)
+				{
+					Link->Returns++;
+				}
+			}
+		}
+
+		const wchar_t* Text(unsigned) override
+		{
+			return L"/gg";
+		}
+	};
+
+	class CLinkGameState : public IGameState
+	{
+	public:
+		bool IsTextboxFocused() override
+		{
+			return GameState.Read().IsTextboxFocused;
+		}
+
+		bool IsInInstance() override
+		{
+			return true;
+		}
+
+		unsigned TextboxOpenings() override
+		{
+			return GameState.Read().TextboxOpenings;
+		}
+
+		bool WaitNextFrame(long long aDeadline) override
+		{
+			unsigned tick = Frames.Current();
+			return Frames.WaitNext(tick, std::chrono::steady_clock::time_point(std::chrono::microseconds(aDeadline)), &GGCancel);
+		}
+	};
+
+	CSystemClock Clock;
+	CFakeClipboard Clipboard{ Clock };
+	CLinkInput Input;
+	CLinkGameState Game;
+	CGGPipeline Pipeline{ Input, Clipboard, Game, Clock, &GGCancel };
+
+	/* AddonPreRender and AddonOptions: one frame of the game, the published snapshot, now and then a settings change */
+	void Render(uint32_t aSeed)
+	{
+		std::mt19937 random(aSeed);
+		unsigned tick = Frames.Current();
+		bool wasFocused = false;
+		unsigned openings = GameState.Read().TextboxOpenings;
+
+		Config.Online(EConfigReader_Render);
+		while (IsRendering.load())
+		{
+			Config.Quiescent(EConfigReader_Render);
+			tick++;
+
+			bool focused;
+			{
+				std::lock_guard<std::mutex> lock(Link->Mutex);
+				for (; Link->Returns > 0; Link->Returns--)
+				{
+					if (Link->IsChatOpen) { Link->Messages++; }
+					Link->IsChatOpen = !Link->IsChatOpen;
+					Link->OpenedAt = tick;
+				}
+				focused = Link->IsChatOpen && tick > Link->OpenedAt;
+			}
+
+			if (focused && !wasFocused)
+			{
+				openings++;
+			}
+			wasFocused = focused;
+			GameState.Publish(GameFrame{ tick, focused, openings });
+			Frames.Publish(tick);
+			if (Pipeline.IsRestorePending() && !focused)
+			{
+				GGSignal.Notify();
+			}
+
+			if (random() % 50 == 0)
+			{
+				EInjectionMode mode = static_cast<EInjectionMode>(random() % 3);
+				Config.Update([mode](AddonConfig& aConfig) { aConfig.InjectionMode = mode; });
+			}
+
+			std::this_thread::sleep_for(std::chrono::microseconds(FRAME_PERIOD));
+		}
+		Config.Offline(EConfigReader_Render);
+	}
+
+	size_t DrainQueue(Trigger* aBatch, size_t aSize)
+	{
+		size_t count = 0;
+		while (count < aSize && GGQueue.Pop(aBatch[count]))
+		{
+			count++;
+		}
+		return count;
+	}
+
+	class CStressWorkerHost : public IWorkerHost
+	{
+	public:
+		void Online() override
+		{
+			Config.Online(EConfigReader_Worker);
+		}
+
+		void Offline() override
+		{
+			Config.Offline(EConfigReader_Worker);
+		}
+
+		size_t Drain(Trigger* aBatch, size_t aSize) override
+		{
+			return DrainQueue(aBatch, aSize);
+		}
+
+		void Send(const Trigger* aTriggers, size_t aCount) override
+		{
+			Pipeline.Run(aTriggers, aCount, *Config.Get());
+		}
+	};
+
+	CStressWorkerHost WorkerHost;
+	CGGWorker Worker{ WorkerHost, Pipeline, GGSignal, Frames, GGCancel };
+
+	void Load(uint32_t aSeed)
+	{
+		Link = new GameLink();
+		IsRendering = true;
+		RenderThread = std::thread(Render, aSeed);
+		Worker.Start();
+	}
+
+	/* returns how long it took from cancelling to the worker being gone */
+	long long Unload()
+	{
+		IsRendering = false;
+		RenderThread.join();
+
+		long long start = Now();
+		Worker.Stop();
+		long long took = Now() - start;
+
+		Trigger dropped;
+		while (GGQueue.Pop(dropped)) {}
+
+		/* nothing can see the link anymore, a key the worker left down would stay down in the game */
+		for (bool isHeld : Link->IsHeld)
+		{
+			CHECK(!isHeld);
+		}
+		CHECK(Clipboard.Text() == L"what the user copied");
+
+		Submitted += Link->Messages;
+		delete Link;
+		Link = nullptr;
+		return took;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned cycles = 300;
+	if (argc == 3 && strcmp(argv[1], "--cycles") == 0)
+	{
+		cycles = static_cast<unsigned>(atoi(argv[2]));
+	}
+
+	GGQueue.CoalesceWindowMs = 0;
+	Clipboard.SetText(L"what the user copied");
+	CompilePhraseTable(Phrases, Config.Get(), StressKeys{});
+
+	/* two threads firing for the whole run, across loads and unloads */
+	std::atomic<bool> isFiring{ true };
+	std::atomic<unsigned long long> fired{ 0 };
+	std::vector<std::thread> firing;
+	for (unsigned f = 0; f < 2; f++)
+	{
+		firing.emplace_back([&, f]
+		{
+			std::mt19937 random(f + 100);
+			while (isFiring.load())
+			{
+				if (GGQueue.Push(f == 0 ? ETriggerSource::Keybind : ETriggerSource::Button, 0))
+				{
+					fired++;
+				}
+				GGSignal.Notify();
+				std::this_thread::sleep_for(std::chrono::microseconds(random() % 4000));
+			}
+		});
+	}
+
+	CHistogram unloads;
+	long long slowest = 0;
+	std::mt19937 random(1);
+	for (unsigned i = 0; i < cycles; i++)
+	{
+		/* sometimes another process holds the clipboard until about when the unload comes, the worker may be backing off when it is told to stop.
+		 * held past the unload the restore on the way out would fail, the user's copy is only lost then */
+		long long loaded = 1 + static_cast<long long>(random() % 30000);
+		Clipboard.BusyUntil = i % 4 == 0 ? Clock.Now() + loaded - 1 : 0;
+		Load(i);
+
+		std::this_thread::sleep_for(std::chrono::microseconds(loaded));
+
+		long long took = Unload();
+		unloads.Record(static_cast<unsigned long long>(took));
+		slowest = std::max(slowest, took);
+	}
+
+	isFiring = false;
+	for (std::thread& thread : firing)
+	{
+		thread.join();
+	}
+
+	printf("%u load/unload cycles, %llu triggers queued, %llu sent, %llu skipped, %llu failed, %llu chat sessions, %llu messages arrived\n",
+		cycles, fired.load(), Pipeline.Sent.load(), Pipeline.Skipped.load(), Pipeline.Failed.load(), Pipeline.Batches.load(), Submitted);
+	/* the histogram reports bucket bounds, above the slowest unload when it is the only one in its bucket */
+	auto percentile = [&](double aPercentile) { return std::min(static_cast<long long>(unloads.Percentile(aPercentile)), slowest) / 1000.0; };
+	printf("unload: p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", percentile(0.50), percentile(0.99), slowest / 1000.0);
+
+	CHECK(Pipeline.Sent > 0);
+	CHECK(Submitted > 0);
+	CHECK(slowest < std::chrono::duration_cast<std::chrono::microseconds>(UNLOAD_BOUND).count());
+
+	/* every unload freed what the settings replaced while it ran */
+	Config.Update([](AddonConfig&) {});
+	CHECK(Config.Pending() == 0);
+
+	return TestResult();
+}
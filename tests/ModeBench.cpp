@@ -0,0 +1,49 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Check.h"
+#include "Scenario.h"
+
+/* End-to-end latency of a GG per injection mode, from the trigger to the frame the game submitted the message,
+ * at a few frame rates on the simulated game. The unicode and window message modes leave out the clipboard and the paste wait.
+ *
+ * usage: modebench [--count N] */
+
+int main(int argc, char** argv)
+{
+	unsigned count = 5000;
+	if (argc == 3 && strcmp(argv[1], "--count") == 0)
+	{
+		count = static_cast<unsigned>(atoi(argv[2]));
+	}
+
+	const EInjectionMode modes[] = { EInjectionMode::Clipboard, EInjectionMode::Unicode, EInjectionMode::WindowMessages };
+	const double rates[] = { 30.0, 60.0, 144.0 };
+
+	printf("%u GGs per run, 500 ms apart, chat shows open 1-3 frames after the Return\n", count);
+	printf("%-10s %5s %12s %12s %12s %12s %16s\n", "mode", "fps", "e2e_p50_ms", "e2e_p95_ms", "e2e_p99_ms", "session_p50", "clipboard_opens");
+
+	for (double rate : rates)
+	{
+		for (EInjectionMode mode : modes)
+		{
+			ScenarioOptions options;
+			options.Bursts = count;
+			options.Mode = mode;
+			options.FramesPerSecond = rate;
+
+			ScenarioResult result = RunScenario(options);
+			printf("%-10s %5.0f %12.2f %12.2f %12.2f %12.2f %16llu\n", ModeName(mode), rate,
+				result.EndToEnd.P50 / 1000.0, result.EndToEnd.P95 / 1000.0, result.EndToEnd.P99 / 1000.0,
+				result.Batch.P50 / 1000.0, result.ClipboardOpens);
+
+			CHECK(result.SuccessRate() == 1.0);
+			CHECK(result.Wrong == 0);
+			CHECK(result.IsClipboardIntact);
+			CHECK(mode == EInjectionMode::Clipboard || result.ClipboardOpens == 0);
+		}
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,225 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "Check.h"
+#include "PhraseTable.h"
+
+/* Micro-benchmark of the key sequences of a GG: the baseline built six one-element input arrays per GG, mapping every key's scan code,
+ * and made a SendInput call per key event. Now CompilePhraseTable() builds every sequence once per config and layout,
+ * and every run of keys between two waits goes out in a single call.
+ * The platform calls are counted on a fake: their kernel cost does not exist here, so ns is only the in-process part.
+ *
+ * usage: phrasebench [--iterations N] */
+
+namespace
+{
+	struct FakeInput
+	{
+		unsigned short	Vk;
+		unsigned short	Scan;
+		unsigned		Flags;
+	};
+
+	struct FakeMessage
+	{
+		unsigned		Message;
+		unsigned		WParam;
+		unsigned		LParam;
+	};
+
+	unsigned long long MapCalls = 0;
+	unsigned long long SendCalls = 0;
+	unsigned long long SentInputs = 0;
+	unsigned long long Checksum = 0;
+
+	/* the layout, volatile so the lookups are not folded away */
+	volatile unsigned short ScanCodes[256];
+
+	/* stands in for MapVirtualKeyExA(MAPVK_VK_TO_VSC) */
+	unsigned short MapVirtualKey(unsigned short aVk)
+	{
+		MapCalls++;
+		return ScanCodes[aVk & 0xFF];
+	}
+
+	/* stands in for SendInput() */
+	void SendInput(unsigned aCount, const FakeInput* aInputs)
+	{
+		SendCalls++;
+		SentInputs += aCount;
+		for (unsigned i = 0; i < aCount; i++)
+		{
+			Checksum += aInputs[i].Scan;
+		}
+	}
+
+	struct FakeKeys
+	{
+		using Input = FakeInput;
+		using Message = FakeMessage;
+
+		static unsigned short VirtualKey(EKey aKey)
+		{
+			switch (aKey)
+			{
+			case EKey::Return:	return 0x0D;
+			case EKey::Control:	return 0xA2;
+			case EKey::V:		return 'V';
+			}
+			return 0;
+		}
+
+		FakeInput Key(EKey aKey, bool aRelease) const
+		{
+			unsigned short vk = VirtualKey(aKey);
+			return FakeInput{ vk, MapVirtualKey(vk), aRelease ? 2u : 0u };
+		}
+
+		FakeInput Unicode(wchar_t aUnit, bool aRelease) const
+		{
+			return FakeInput{ 0, static_cast<unsigned short>(aUnit), aRelease ? 6u : 4u };
+		}
+
+		void AppendKeyMessages(std::vector<FakeMessage>& aMessages, EKey aKey) const
+		{
+			unsigned short vk = VirtualKey(aKey);
+			unsigned short scanCode = MapVirtualKey(vk);
+			aMessages.push_back(FakeMessage{ 0x100, vk, scanCode });
+			aMessages.push_back(FakeMessage{ 0x101, vk, scanCode });
+		}
+
+		FakeMessage Char(wchar_t aUnit) const
+		{
+			return FakeMessage{ 0x102, static_cast<unsigned>(aUnit), 0 };
+		}
+	};
+
+	/* the baseline: the sequence of one GG built and sent key by key, as PerformSudoku() did before the phrase table */
+	void BaselineGG()
+	{
+		FakeInput retPress[1] = { { 0x0D, MapVirtualKey(0x0D), 0 } };
+		FakeInput retRelease[1] = { { 0x0D, MapVirtualKey(0x0D), 2 } };
+		FakeInput lctrlPress[1] = { { 0xA2, MapVirtualKey(0xA2), 0 } };
+		FakeInput lctrlRelease[1] = { { 0xA2, MapVirtualKey(0xA2), 2 } };
+		FakeInput vPress[1] = { { 'V', MapVirtualKey('V'), 0 } };
+		FakeInput vRelease[1] = { { 'V', MapVirtualKey('V'), 2 } };
+
+		SendInput(1, retPress);
+		SendInput(1, retRelease);
+		SendInput(1, lctrlPress);
+		SendInput(1, vPress);
+		SendInput(1, vRelease);
+		SendInput(1, lctrlRelease);
+		SendInput(1, retPress);
+		SendInput(1, retRelease);
+	}
+
+	void Send(const BasicPhraseTable<FakeKeys>& aTable, const InputRun& aRun)
+	{
+		SendInput(static_cast<unsigned>(aRun.Count), &aTable.Inputs[aRun.Offset]);
+	}
+
+	double NsSince(std::chrono::steady_clock::time_point aStart, unsigned aIterations)
+	{
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - aStart).count() / aIterations;
+	}
+
+	void ResetCounts()
+	{
+		MapCalls = 0;
+		SendCalls = 0;
+		SentInputs = 0;
+	}
+
+	void Row(const char* aName, double aBuildNs, unsigned aIterations)
+	{
+		printf("%-30s %12.1f %12.2f %12.2f %14.2f\n", aName, aBuildNs,
+			static_cast<double>(MapCalls) / aIterations, static_cast<double>(SendCalls) / aIterations,
+			SendCalls > 0 ? static_cast<double>(SentInputs) / SendCalls : 0.0);
+	}
+
+	void CheckUtf16(const char* aUtf8, std::vector<wchar_t> aExpected)
+	{
+		std::vector<wchar_t> text;
+		AppendUtf16(text, aUtf8);
+		aExpected.push_back(L'\0');
+		CHECK(text == aExpected);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned iterations = 200000;
+	if (argc == 3 && strcmp(argv[1], "--iterations") == 0)
+	{
+		iterations = static_cast<unsigned>(atoi(argv[2]));
+	}
+
+	CheckUtf16("/gg", { L'/', L'g', L'g' });
+	CheckUtf16("\xC3\xA9\xE2\x82\xAC", { 0xE9, 0x20AC });
+	CheckUtf16("\xF0\x9F\x98\x80", { 0xD83D, 0xDE00 });
+	CheckUtf16("\xC0\xAF" "a\xE2\x82", { 0xFFFD, 0xFFFD, L'a', 0xFFFD });
+	CheckUtf16("\xED\xA0\x80", { 0xFFFD });
+
+	ScanCodes[0x0D] = 0x1C;
+	ScanCodes[0xA2] = 0x1D;
+	ScanCodes['V'] = 0x2F;
+
+	AddonConfig config;
+	config.PhraseCount = static_cast<int>(MAX_PHRASES);
+	for (size_t i = 0; i < MAX_PHRASES; i++)
+	{
+		snprintf(config.Phrases[i], PHRASE_LENGTH, "/gg %zu, thanks for the run \xE2\x9D\xA4", i);
+	}
+
+	BasicPhraseTable<FakeKeys> table{};
+	FakeKeys keys;
+
+	printf("%u iterations, %zu phrases of %zu characters\n", iterations, MAX_PHRASES, strlen(config.Phrases[0]));
+	printf("%-30s %12s %12s %12s %14s\n", "", "ns", "map_calls", "send_calls", "inputs/call");
+
+	ResetCounts();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned i = 0; i < iterations; i++)
+	{
+		CompilePhraseTable(table, &config, keys);
+	}
+	Row("compile table (once per config)", NsSince(start, iterations), iterations);
+	CHECK(MapCalls / iterations == 9 + 2 * MAX_PHRASES + MAX_PHRASES + 1);
+
+	ResetCounts();
+	start = std::chrono::steady_clock::now();
+	for (unsigned i = 0; i < iterations; i++)
+	{
+		BaselineGG();
+	}
+	Row("baseline GG, clipboard", NsSince(start, iterations), iterations);
+	CHECK(SendCalls / iterations == 8);
+
+	ResetCounts();
+	start = std::chrono::steady_clock::now();
+	for (unsigned i = 0; i < iterations; i++)
+	{
+		Send(table, table.Open);
+		Send(table, table.Paste);
+		Send(table, table.PasteSubmit);
+	}
+	Row("compiled GG, clipboard", NsSince(start, iterations), iterations);
+	CHECK(MapCalls == 0 && SendCalls / iterations == 3);
+
+	ResetCounts();
+	start = std::chrono::steady_clock::now();
+	for (unsigned i = 0; i < iterations; i++)
+	{
+		Send(table, table.Open);
+		Send(table, table.TypeSubmit[i % MAX_PHRASES]);
+	}
+	Row("compiled GG, unicode", NsSince(start, iterations), iterations);
+	CHECK(MapCalls == 0 && SendCalls / iterations == 2);
+
+	printf("checksum %llu\n", Checksum);
+	return TestResult();
+}
@@ -0,0 +1,124 @@
+#include <string>
+
+#include "Check.h"
+#include "Fakes.h"
+#include "Settings.h"
+
+/* CGGPipeline on the simulated game: a batch while the restore of the last one is pending follows it into a chat that is still ours,
+ * but never into one the player opened since, where its Return would submit the player's draft. */
+
+namespace
+{
+	const wchar_t* PHRASE = L"/gg";
+
+	struct Fixture
+	{
+		CVirtualClock	Clock;
+		CFakeClipboard	Clipboard{ Clock };
+		CSimulatedGame	Game{ Clock, Clipboard, 16667 };
+		CFakeInput		Input{ Clock, Game, { PHRASE } };
+		CGGPipeline		Pipeline{ Input, Clipboard, Game, Clock };
+		AddonConfig		Config;
+
+		Fixture()
+		{
+			Clock.Time = 1000000;
+			Game.FocusDelayMin = Game.FocusDelayMax = 2;
+			Clipboard.SetText(L"what the user copied");
+		}
+
+		unsigned Send()
+		{
+			Trigger trigger{ ETriggerSource::Keybind, 0, Clock.Now() };
+			return Pipeline.Run(&trigger, 1, Config);
+		}
+
+		/* lets the game run without the worker looking at the restore */
+		void Frames(unsigned aCount)
+		{
+			for (unsigned i = 0; i < aCount; i++)
+			{
+				Game.WaitNextFrame(Clock.Now() + 1000000);
+			}
+			Game.IsTextboxFocused();
+		}
+
+		unsigned Delivered() const
+		{
+			unsigned delivered = 0;
+			for (const CSimulatedGame::Message& message : Game.Messages)
+			{
+				delivered += message.Text == PHRASE ? 1 : 0;
+			}
+			return delivered;
+		}
+	};
+
+	/* the chat still shows open from our own submit, the next batch goes out right behind it */
+	void ContinuesOwnChat()
+	{
+		Fixture fixture;
+		CHECK(fixture.Send() == 1);
+		CHECK(fixture.Pipeline.IsRestorePending());
+		CHECK(fixture.Game.IsTextboxFocused());
+
+		CHECK(fixture.Send() == 1);
+		fixture.Frames(10);
+		CHECK(fixture.Pipeline.FinishRestore());
+
+		CHECK(fixture.Game.Messages.size() == 2 && fixture.Delivered() == 2);
+		CHECK(fixture.Clipboard.Text() == L"what the user copied");
+	}
+
+	/* the chat closed, the player opened it again and is typing: the batch is skipped, the draft stays as it was */
+	void SkipsPlayersChat()
+	{
+		Fixture fixture;
+		CHECK(fixture.Send() == 1);
+		fixture.Frames(3);
+		CHECK(!fixture.Game.IsTextboxFocused());
+		CHECK(fixture.Pipeline.IsRestorePending());
+
+		fixture.Game.PressReturn(fixture.Clock.Now());
+		fixture.Game.TypeText(fixture.Clock.Now(), L"brb");
+		fixture.Frames(3);
+		CHECK(fixture.Game.IsTextboxFocused());
+
+		CHECK(fixture.Send() == 0);
+		CHECK(fixture.Pipeline.Skipped == 1);
+		fixture.Frames(10);
+
+		CHECK(fixture.Game.Messages.size() == 1 && fixture.Delivered() == 1);
+		CHECK(fixture.Game.Draft() == L"brb");
+
+		/* the deadline still brings the clipboard back while the player keeps typing */
+		fixture.Clock.SleepUntil(fixture.Pipeline.RestoreDeadline());
+		CHECK(fixture.Pipeline.FinishRestore());
+		CHECK(fixture.Clipboard.Text() == L"what the user copied");
+	}
+
+	/* the chat closed and nobody opened it, the batch opens a new one and the saved copy stays what the user had */
+	void KeepsSavedCopy()
+	{
+		Fixture fixture;
+		CHECK(fixture.Send() == 1);
+		fixture.Frames(3);
+		CHECK(!fixture.Game.IsTextboxFocused());
+		CHECK(fixture.Pipeline.IsRestorePending());
+
+		CHECK(fixture.Send() == 1);
+		fixture.Frames(10);
+		CHECK(fixture.Pipeline.FinishRestore());
+
+		CHECK(fixture.Game.Messages.size() == 2 && fixture.Delivered() == 2);
+		CHECK(fixture.Clipboard.Text() == L"what the user copied");
+	}
+}
+
+int main()
+{
+	ContinuesOwnChat();
+	SkipsPlayersChat();
+	KeepsSavedCopy();
+	return TestResult();
+}
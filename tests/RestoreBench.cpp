@@ -0,0 +1,57 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Check.h"
+#include "Scenario.h"
+
+/* End-to-end latency of back-to-back triggers with the clipboard restore waiting inline for the chat to close, as the worker did before,
+ * against the restore deferred to the frame the chat closes, with the worker free to serve the next trigger meanwhile.
+ * Bursts of two triggers some ms apart, clipboard mode on the simulated game at 60 fps.
+ *
+ * usage: restorebench [--count N] */
+
+int main(int argc, char** argv)
+{
+	unsigned count = 500;
+	if (argc == 3 && strcmp(argv[1], "--count") == 0)
+	{
+		count = static_cast<unsigned>(atoi(argv[2]));
+	}
+
+	const long long spacings[] = { 16000, 50000, 100000, 200000 };
+
+	printf("%u bursts of 2 per run, 3 s apart, chat shows open 1-3 frames after the Return\n", count);
+	printf("%-10s %10s %12s %12s %10s %16s\n", "", "apart_ms", "e2e_p50_ms", "e2e_p99_ms", "sessions", "clipboard_opens");
+
+	for (long long spacing : spacings)
+	{
+		ScenarioResult results[2];
+		for (int inline_ = 0; inline_ < 2; inline_++)
+		{
+			ScenarioOptions options;
+			options.Bursts = count;
+			options.BurstSize = 2;
+			options.BurstSpacing = spacing;
+			options.BurstInterval = 3000000;
+			options.IsRestoreInline = inline_ != 0;
+
+			ScenarioResult& result = results[inline_];
+			result = RunScenario(options);
+			printf("%-10s %10.0f %12.2f %12.2f %10llu %16llu\n", inline_ ? "inline" : "deferred", spacing / 1000.0,
+				result.EndToEnd.P50 / 1000.0, result.EndToEnd.P99 / 1000.0, result.Batch.Count, result.ClipboardOpens);
+
+			CHECK(result.SuccessRate() == 1.0);
+			CHECK(result.Wrong == 0);
+			CHECK(result.IsClipboardIntact);
+		}
+
+		/* the second trigger no longer waits for the first one's chat to close */
+		const ScenarioResult& deferred = results[0];
+		const ScenarioResult& inlined = results[1];
+		CHECK(deferred.EndToEnd.P99 <= inlined.EndToEnd.P99);
+		CHECK(deferred.ClipboardOpens <= inlined.ClipboardOpens);
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,176 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Allocations.h"
+#include "Check.h"
+#include "KeyNames.h"
+
+/* Load and lookup cost of the scancode names: the baseline filled a std::map<unsigned short, std::string> with 510 GetKeyNameTextA calls in AddonLoad,
+ * leaking a 64 byte buffer per scancode, now CScancodeNames builds one arena per keyboard layout the first time it is asked.
+ * GetKeyNameTextA is a fake that formats a name, so the times are the in-process part, the name calls are counted.
+ * GetScancodeName() is only used by KeybindToString(), which has no caller in the addon, neither now nor in the baseline.
+ *
+ * usage: scancodebench [--iterations N] */
+
+namespace
+{
+	unsigned long long NameCalls = 0;
+
+	/* stands in for GetKeyNameTextA, aLayout picks the language of the names */
+	int GetKeyNameText(int aLayout, unsigned short aScanCode, char* aBuffer, int aSize)
+	{
+		NameCalls++;
+		return snprintf(aBuffer, static_cast<size_t>(aSize), "%s %s%02X", aLayout == 0 ? "Key" : aLayout == 1 ? "Taste" : "Touche", (aScanCode & 0xE000) ? "E0 " : "", aScanCode & 0xFF);
+	}
+
+	/* the baseline load, as AddonLoad() did it */
+	void BuildBaseline(std::map<unsigned short, std::string>& aTable)
+	{
+		for (unsigned i = 0; i < 255; i++)
+		{
+			unsigned short scanCode = static_cast<unsigned short>(i);
+			char* buff = new char[64];
+			std::string str;
+			GetKeyNameText(0, scanCode, buff, 64);
+			str.append(buff);
+			aTable[scanCode] = str;
+
+			/* the baseline leaked this buffer, the benchmark frees it so it can run under the address sanitizer */
+			delete[] buff;
+
+			scanCode |= 0xE000;
+			buff = new char[64];
+			str = "";
+			GetKeyNameText(0, scanCode, buff, 64);
+			str.append(buff);
+			aTable[scanCode] = str;
+
+			delete[] buff;
+		}
+	}
+
+	struct Measured
+	{
+		double				Ns;
+		unsigned long long	Allocations;
+		unsigned long long	NameCalls;
+	};
+
+	template<typename F>
+	Measured Measure(unsigned aIterations, F aRun)
+	{
+		unsigned long long allocations = Allocations();
+		unsigned long long names = NameCalls;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (unsigned i = 0; i < aIterations; i++)
+		{
+			aRun(i);
+		}
+		double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		return Measured{ ns / aIterations, (Allocations() - allocations) / aIterations, (NameCalls - names) / aIterations };
+	}
+
+	void Row(const char* aName, const Measured& aMeasured)
+	{
+		printf("%-34s %12.1f %12llu %12llu\n", aName, aMeasured.Ns, aMeasured.Allocations, aMeasured.NameCalls);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned iterations = 2000;
+	if (argc == 3 && strcmp(argv[1], "--iterations") == 0)
+	{
+		iterations = static_cast<unsigned>(atoi(argv[2]));
+	}
+	unsigned lookups = iterations * 100;
+
+	auto nameOf = [](int aLayout)
+	{
+		return [aLayout](unsigned short aScanCode, char* aBuffer, int aSize) { return GetKeyNameText(aLayout, aScanCode, aBuffer, aSize); };
+	};
+
+	/* what a keybind UI asks for: letters, digits, modifiers and the odd extended key */
+	std::vector<unsigned short> keys(4096);
+	std::mt19937 random(1);
+	for (unsigned short& key : keys)
+	{
+		key = static_cast<unsigned short>(std::uniform_int_distribution<int>(1, 0x58)(random) | (random() % 8 == 0 ? 0xE000 : 0));
+	}
+
+	printf("%-34s %12s %12s %12s\n", "", "ns", "allocations", "name_calls");
+
+	Measured baselineLoad = Measure(iterations, [](unsigned)
+	{
+		std::map<unsigned short, std::string> table;
+		BuildBaseline(table);
+	});
+	Row("baseline load (AddonLoad)", baselineLoad);
+
+	Row("table load (AddonLoad)", Measure(iterations, [](unsigned)
+	{
+		CScancodeNames<int> names;
+	}));
+
+	Measured firstLookup = Measure(iterations, [&](unsigned)
+	{
+		CScancodeNames<int> names;
+		names.Get(0, 0x1C, nameOf(0));
+	});
+	Row("table build (first lookup)", firstLookup);
+
+	std::map<unsigned short, std::string> baseline;
+	BuildBaseline(baseline);
+	size_t found = 0;
+	Measured baselineLookup = Measure(lookups, [&](unsigned i)
+	{
+		auto it = baseline.find(keys[i % keys.size()]);
+		found += it != baseline.end() ? it->second.size() : 0;
+	});
+	Row("baseline lookup (std::map)", baselineLookup);
+
+	CScancodeNames<int> names;
+	names.Get(0, 0x1C, nameOf(0));
+	names.Get(1, 0x1C, nameOf(1));
+	Measured tableLookup = Measure(lookups, [&](unsigned i)
+	{
+		found += strlen(names.Get(0, keys[i % keys.size()], nameOf(0)));
+	});
+	Row("table lookup", tableLookup);
+
+	Measured switchedLookup = Measure(lookups, [&](unsigned i)
+	{
+		found += strlen(names.Get(i % 2, keys[i % keys.size()], nameOf(i % 2)));
+	});
+	Row("table lookup, two layouts", switchedLookup);
+	printf("checksum %zu\n", found);
+
+	/* same names as the baseline, a second layout gets its own table once and its own names */
+	for (unsigned i = 0; i < 255; i++)
+	{
+		CHECK(baseline[static_cast<unsigned short>(i)] == names.Get(0, static_cast<unsigned short>(i), nameOf(0)));
+		CHECK(baseline[static_cast<unsigned short>(i | 0xE000)] == names.Get(0, static_cast<unsigned short>(i | 0xE000), nameOf(0)));
+	}
+	CHECK(strncmp(names.Get(1, 0x1C, nameOf(1)), "Taste", 5) == 0);
+	CHECK(names.Builds == 2);
+	CHECK(baselineLoad.NameCalls == 510);
+	CHECK(tableLookup.Allocations == 0 && switchedLookup.Allocations == 0);
+	CHECK(tableLookup.NameCalls == 0);
+
+	/* a layout past the last slot gets its own names, uncached, not those of a cached layout */
+	CScancodeNames<int, 2> full;
+	full.Get(0, 0x1C, nameOf(0));
+	full.Get(1, 0x1C, nameOf(1));
+	CHECK(strcmp(full.Get(2, 0x1C, nameOf(2)), "Touche 1C") == 0);
+	CHECK(strcmp(full.Get(2, 0xE01C, nameOf(2)), "Touche E0 1C") == 0);
+	CHECK(strcmp(full.Get(0, 0x1C, nameOf(0)), "Key 1C") == 0);
+	CHECK(full.Builds == 2 && full.Uncached == 2);
+
+	return TestResult();
+}
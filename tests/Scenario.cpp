@@ -0,0 +1,245 @@
+#include "Scenario.h"
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "Fakes.h"
+#include "Settings.h"
+
+namespace
+{
+	const wchar_t* PHRASE = L"/gg";
+}
+
+const char* ModeName(EInjectionMode aMode)
+{
+	switch (aMode)
+	{
+	case EInjectionMode::Clipboard:			return "clipboard";
+	case EInjectionMode::Unicode:			return "unicode";
+	case EInjectionMode::WindowMessages:	return "messages";
+	}
+	return "?";
+}
+
+ScenarioResult RunScenario(const ScenarioOptions& aOptions)
+{
+	std::unique_ptr<IClock> clock;
+	if (aOptions.IsRealtime)
+	{
+		clock.reset(new CSystemClock());
+	}
+	else
+	{
+		CVirtualClock* time = new CVirtualClock();
+		time->Time = 1000000;
+		clock.reset(time);
+	}
+
+	CFakeClipboard clipboard(*clock);
+	CSimulatedGame game(*clock, clipboard, static_cast<long long>(1000000.0 / aOptions.FramesPerSecond), aOptions.Seed);
+	game.FocusDelayMin = aOptions.FocusDelayMin;
+	game.FocusDelayMax = aOptions.FocusDelayMax;
+	CFakeInput input(*clock, game, { PHRASE });
+	CGGPipeline pipeline(input, clipboard, game, *clock);
+
+	AddonConfig config;
+	config.InjectionMode = aOptions.Mode;
+	config.RestoreClipboard = aOptions.RestoreClipboard;
+
+	/* what the user had copied: some text and a binary format, both have to come back byte for byte */
+	clipboard.SetText(L"what the user copied");
+	std::vector<unsigned char> blob(aOptions.ClipboardBytes);
+	for (size_t i = 0; i < blob.size(); i++)
+	{
+		blob[i] = static_cast<unsigned char>(i * 131 + 7);
+	}
+	if (!blob.empty())
+	{
+		clipboard.SetFormat(0xC001, blob.data(), blob.size());
+	}
+	std::map<unsigned, std::vector<unsigned char>> original = clipboard.Formats;
+
+	CHistogram endToEnd;
+	ScenarioResult result;
+	std::vector<Trigger> batch(aOptions.BurstSize);
+
+	/* trigger times of the messages the pipeline reported sent, oldest first, matched to what the game receives */
+	std::deque<long long> inFlight;
+	size_t received = 0;
+	auto collect = [&]()
+	{
+		game.IsTextboxFocused();
+		for (; received < game.Messages.size(); received++)
+		{
+			const CSimulatedGame::Message& message = game.Messages[received];
+			if (message.Text == PHRASE && !inFlight.empty())
+			{
+				result.Delivered++;
+				endToEnd.Record(static_cast<unsigned long long>(message.Time - inFlight.front()));
+				inFlight.pop_front();
+			}
+			else
+			{
+				result.Wrong++;
+			}
+		}
+	};
+
+	/* like the worker: while the restore waits for the chat to close, look at every frame until aTime */
+	auto idleUntil = [&](long long aTime)
+	{
+		while (pipeline.IsRestorePending() && clock->Now() < aTime)
+		{
+			long long deadline = pipeline.RestoreDeadline() < aTime ? pipeline.RestoreDeadline() : aTime;
+			game.WaitNextFrame(deadline);
+			pipeline.FinishRestore();
+		}
+		clock->SleepUntil(aTime);
+	};
+
+	/* blocks until the chat closed and the clipboard is back, or the restore deadline passed */
+	auto finishRestoreInline = [&]()
+	{
+		while (pipeline.IsRestorePending() && game.WaitNextFrame(pipeline.RestoreDeadline()))
+		{
+			pipeline.FinishRestore();
+		}
+		pipeline.FinishRestore(true);
+	};
+
+	std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+	long long start = clock->Now();
+	long long burst = start;
+
+	for (unsigned i = 0; i < aOptions.Bursts; i++)
+	{
+		idleUntil(burst);
+		collect();
+
+		if (aOptions.Contention > 0)
+		{
+			clipboard.BusyUntil = burst + aOptions.Contention;
+		}
+
+		for (size_t t = 0; t < batch.size(); t++)
+		{
+			batch[t] = Trigger{ ETriggerSource::Keybind, 0, burst + static_cast<long long>(t) * aOptions.BurstSpacing };
+		}
+		result.Triggers += batch.size();
+
+		if (aOptions.IsBatched)
+		{
+			/* everything that arrived by the time the worker gets to it goes in one batch */
+			for (size_t first = 0; first < batch.size();)
+			{
+				idleUntil(batch[first].Timestamp);
+				size_t count = 1;
+				while (first + count < batch.size() && batch[first + count].Timestamp <= clock->Now())
+				{
+					count++;
+				}
+
+				unsigned sent = pipeline.Run(&batch[first], count, config);
+				for (unsigned s = 0; s < sent; s++)
+				{
+					inFlight.push_back(batch[first + s].Timestamp);
+				}
+				pipeline.FinishRestore();
+				if (aOptions.IsRestoreInline)
+				{
+					finishRestoreInline();
+				}
+				first += count;
+			}
+		}
+		else
+		{
+			for (const Trigger& trigger : batch)
+			{
+				idleUntil(trigger.Timestamp);
+
+				/* nothing carries over into the next session, it starts once the last one is over */
+				long long closed = clock->Now() + std::chrono::duration_cast<std::chrono::microseconds>(RESTORE_WAIT_TIMEOUT).count();
+				while ((pipeline.IsRestorePending() || game.IsTextboxFocused()) && game.WaitNextFrame(closed))
+				{
+					pipeline.FinishRestore();
+				}
+				pipeline.FinishRestore(true);
+
+				unsigned sent = pipeline.Run(&trigger, 1, config);
+				inFlight.insert(inFlight.end(), sent, trigger.Timestamp);
+				pipeline.FinishRestore();
+			}
+		}
+
+		burst += aOptions.BurstInterval;
+		if (burst < clock->Now())
+		{
+			burst = clock->Now();
+		}
+	}
+
+	/* the last submits land and the chat closes within a few frames */
+	long long settled = clock->Now() + 10 * game.Period();
+	while (game.WaitNextFrame(settled))
+	{
+		pipeline.FinishRestore();
+	}
+	pipeline.FinishRestore(true);
+	collect();
+
+	result.WallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+	result.SimulatedSeconds = (clock->Now() - start) / 1000000.0;
+	result.Sent = pipeline.Sent;
+	result.Skipped = pipeline.Skipped;
+	result.Failed = pipeline.Failed;
+	result.ClipboardOpens = pipeline.ClipboardAttempts;
+	result.ClipboardRetries = pipeline.ClipboardRetries;
+	result.ClipboardFailures = pipeline.ClipboardFailures;
+	for (unsigned long long calls : input.Calls)
+	{
+		result.InputCalls += calls;
+	}
+	result.IsClipboardIntact = clipboard.Formats == original;
+
+	for (int i = 0; i < static_cast<int>(EStage::COUNT); i++)
+	{
+		result.Stages[i] = Percentiles::Of(pipeline.StageLatency[i]);
+	}
+	result.Batch = Percentiles::Of(pipeline.BatchDuration);
+	result.ClipboardWait = Percentiles::Of(pipeline.ClipboardWait);
+	result.EndToEnd = Percentiles::Of(endToEnd);
+	return result;
+}
+
+void PrintResult(FILE* aFile, const ScenarioOptions& aOptions, const ScenarioResult& aResult)
+{
+	fprintf(aFile, "%s clock, %s mode, %u bursts of %u%s %.0f ms apart%s, %.0f fps, focus after %u-%u frames\n",
+		aOptions.IsRealtime ? "real" : "virtual", ModeName(aOptions.Mode), aOptions.Bursts, aOptions.BurstSize, aOptions.IsBatched ? "" : " one by one",
+		aOptions.BurstSpacing / 1000.0, aOptions.IsRestoreInline ? ", restoring inline" : "",
+		aOptions.FramesPerSecond, aOptions.FocusDelayMin, aOptions.FocusDelayMax);
+	fprintf(aFile, "triggers %llu, sent %llu, skipped %llu, failed %llu, delivered %llu, wrong %llu, success %.2f%%\n",
+		aResult.Triggers, aResult.Sent, aResult.Skipped, aResult.Failed, aResult.Delivered, aResult.Wrong, aResult.SuccessRate() * 100.0);
+	fprintf(aFile, "throughput %.0f sequences/s wall, %.2f sequences/s simulated, %.2f input calls per message\n",
+		aResult.WallSeconds > 0 ? aResult.Sent / aResult.WallSeconds : 0.0,
+		aResult.SimulatedSeconds > 0 ? aResult.Sent / aResult.SimulatedSeconds : 0.0,
+		aResult.Sent > 0 ? static_cast<double>(aResult.InputCalls) / aResult.Sent : 0.0);
+	fprintf(aFile, "clipboard opens %llu, retries %llu, failures %llu, user clipboard %s\n",
+		aResult.ClipboardOpens, aResult.ClipboardRetries, aResult.ClipboardFailures, aResult.IsClipboardIntact ? "intact" : "CHANGED");
+
+	fprintf(aFile, "%-20s %8s %10s %10s %10s\n", "stage", "samples", "p50_ms", "p95_ms", "p99_ms");
+	auto row = [aFile](const char* aName, const Percentiles& aValue)
+	{
+		fprintf(aFile, "%-20s %8llu %10.2f %10.2f %10.2f\n", aName, aValue.Count, aValue.P50 / 1000.0, aValue.P95 / 1000.0, aValue.P99 / 1000.0);
+	};
+	for (int i = 0; i < static_cast<int>(EStage::COUNT); i++)
+	{
+		row(StageNames[i], aResult.Stages[i]);
+	}
+	row("Chat session", aResult.Batch);
+	row("Clipboard contention", aResult.ClipboardWait);
+	row("Trigger to chat", aResult.EndToEnd);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "Histogram.h"
+#include "Pipeline.h"
+
+/* One scripted play session: bursts of triggers fired at a fixed interval into a simulated game. */
+struct ScenarioOptions
+{
+	unsigned		Bursts = 1000;
+	unsigned		BurstSize = 1;			/* triggers fired at once */
+	bool			IsBatched = true;		/* false sends a burst one trigger per chat session, each after the chat closed and the clipboard was restored, like before batching */
+	long long		BurstSpacing = 0;		/* microseconds from one trigger of a burst to the next, 0 fires them at once */
+	bool			IsRestoreInline = false;	/* wait for the chat to close and restore before serving the next trigger, like before the restore was deferred */
+	long long		BurstInterval = 500000;	/* microseconds from one burst to the next */
+	bool			IsRealtime = false;		/* sleep for real instead of moving a virtual clock */
+	EInjectionMode	Mode = EInjectionMode::Clipboard;
+	bool			RestoreClipboard = true;
+	double			FramesPerSecond = 60.0;
+	unsigned		FocusDelayMin = 1;		/* frames until MumbleLink shows the chat open */
+	unsigned		FocusDelayMax = 3;
+	long long		Contention = 0;			/* microseconds another process holds the clipboard before every burst */
+	size_t			ClipboardBytes = 64;	/* size of the user's clipboard content besides its text */
+	uint32_t		Seed = 1;
+};
+
+struct Percentiles
+{
+	unsigned long long	Count;
+	unsigned long long	P50;
+	unsigned long long	P95;
+	unsigned long long	P99;
+
+	static Percentiles Of(const CHistogram& aHistogram)
+	{
+		return Percentiles{ aHistogram.Count(), aHistogram.Percentile(0.50), aHistogram.Percentile(0.95), aHistogram.Percentile(0.99) };
+	}
+};
+
+struct ScenarioResult
+{
+	unsigned long long	Triggers = 0;
+	unsigned long long	Sent = 0;
+	unsigned long long	Skipped = 0;
+	unsigned long long	Failed = 0;
+	unsigned long long	Delivered = 0;		/* messages the game received with the right text */
+	unsigned long long	Wrong = 0;			/* messages the game received with any other text */
+	unsigned long long	InputCalls = 0;
+	unsigned long long	ClipboardOpens = 0;
+	unsigned long long	ClipboardRetries = 0;
+	unsigned long long	ClipboardFailures = 0;
+	bool				IsClipboardIntact = false;	/* the user's clipboard was back to what it was after the last burst */
+	double				WallSeconds = 0;
+	double				SimulatedSeconds = 0;
+
+	Percentiles			Stages[static_cast<int>(EStage::COUNT)]{};
+	Percentiles			Batch{};
+	Percentiles			ClipboardWait{};
+	Percentiles			EndToEnd{};			/* trigger to the frame the game submitted the message, microseconds */
+
+	double SuccessRate() const
+	{
+		return Triggers > 0 ? static_cast<double>(Delivered) / Triggers : 0.0;
+	}
+};
+
+ScenarioResult RunScenario(const ScenarioOptions& aOptions);
+
+void PrintResult(FILE* aFile, const ScenarioOptions& aOptions, const ScenarioResult& aResult);
+
+const char* ModeName(EInjectionMode aMode);
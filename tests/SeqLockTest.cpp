@@ -0,0 +1,267 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "Check.h"
+#include "SeqLock.h"
+
+/* Torture test of the MumbleLink snapshot path: ReadVersioned() copying a block another thread rewrites in place, and CSeqLock sharing the copy.
+ * Every word of a frame holds the frame number, a copy mixing two frames is torn. Prints the cost per read with and without a writer
+ * and how many torn copies each one returned.
+ * ReadVersioned() races with the writer by design, MumbleLink is another process' memory, so that part is left out of the thread sanitizer build.
+ *
+ * usage: seqlock_test [--seconds S] */
+
+#if defined(__SANITIZE_THREAD__)
+#define SLASHGG_TSAN 1
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define SLASHGG_TSAN 1
+#endif
+#endif
+
+namespace
+{
+	const size_t READERS = 3;
+
+	/* the size of Mumble::Context */
+	struct Frame
+	{
+		uint32_t	Words[64];
+
+		void Fill(uint32_t aFrame)
+		{
+			for (uint32_t& word : Words)
+			{
+				word = aFrame;
+			}
+		}
+
+		bool IsTorn() const
+		{
+			for (uint32_t word : Words)
+			{
+				if (word != Words[0]) { return true; }
+			}
+			return false;
+		}
+	};
+
+	struct Snapshot
+	{
+		unsigned	Tick;
+		Frame		Context;
+	};
+
+	struct Counts
+	{
+		std::atomic<unsigned long long>	Reads{ 0 };
+		std::atomic<unsigned long long>	Torn{ 0 };
+		std::atomic<unsigned long long>	Backwards{ 0 };
+		std::atomic<unsigned long long>	Failed{ 0 };
+		std::atomic<unsigned long long>	Retries{ 0 };
+		std::atomic<unsigned long long>	Mismatched{ 0 };	/* copy consistent, but not of the frame its tick says */
+		double							Seconds = 0;
+
+		/* readers running at once, on fewer cores they share the wall time */
+		double NsPerRead() const
+		{
+			unsigned cores = std::thread::hardware_concurrency();
+			double parallel = static_cast<double>(cores > 0 && cores < READERS ? cores : READERS);
+			return Reads ? Seconds * 1e9 * parallel / Reads : 0;
+		}
+	};
+
+	enum class EWriter
+	{
+		None,
+		Paced,		/* a frame every millisecond, faster than any game but idle in between like it */
+		Nonstop		/* rewriting without a pause, the writer is mostly preempted mid-write */
+	};
+
+	const char* WriterName(EWriter aWriter)
+	{
+		switch (aWriter)
+		{
+			case EWriter::Paced:	return "writer at 1000 fps";
+			case EWriter::Nonstop:	return "writer nonstop";
+			default:				return "no writer";
+		}
+	}
+
+	/* runs aReaders reader threads and a writer thread for aSeconds */
+	template<typename TWrite, typename TRead>
+	void Torture(double aSeconds, size_t aReaders, EWriter aWriter, TWrite aWrite, TRead aRead, Counts& aCounts)
+	{
+		std::atomic<bool> stop{ false };
+
+		std::thread writer;
+		if (aWriter != EWriter::None)
+		{
+			writer = std::thread([&]
+			{
+				std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+				for (uint32_t frame = 1; !stop.load(std::memory_order_relaxed); frame++)
+				{
+					aWrite(frame);
+					if (aWriter == EWriter::Paced)
+					{
+						next += std::chrono::milliseconds(1);
+						std::this_thread::sleep_until(next);
+					}
+				}
+			});
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::vector<std::thread> readers;
+		for (size_t r = 0; r < aReaders; r++)
+		{
+			readers.emplace_back([&]
+			{
+				unsigned long long reads = 0;
+				uint32_t last = 0;
+				while (!stop.load(std::memory_order_relaxed))
+				{
+					uint32_t frame = 0;
+					if (aRead(frame))
+					{
+						if (frame < last) { aCounts.Backwards++; }
+						last = frame;
+					}
+					reads++;
+				}
+				aCounts.Reads += reads;
+			});
+		}
+
+		std::this_thread::sleep_for(std::chrono::duration<double>(aSeconds));
+		stop = true;
+		for (std::thread& reader : readers)
+		{
+			reader.join();
+		}
+		if (writer.joinable())
+		{
+			writer.join();
+		}
+		aCounts.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void Row(const char* aName, EWriter aWriter, const Counts& aCounts)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "%s, %s", aName, WriterName(aWriter));
+		printf("%-38s %12llu %10.1f %10llu %10llu %10llu\n", name, aCounts.Reads.load(), aCounts.NsPerRead(), aCounts.Retries.load(), aCounts.Failed.load(), aCounts.Torn.load());
+	}
+
+	/* one writer publishing as fast as it can, torn or reordered reads are bugs */
+	void SeqLock(double aSeconds)
+	{
+		for (EWriter writer : { EWriter::None, EWriter::Paced, EWriter::Nonstop })
+		{
+			CSeqLock<Snapshot> lock;
+			Counts counts;
+			Torture(aSeconds, READERS, writer, [&](uint32_t aFrame)
+			{
+				Snapshot snapshot;
+				snapshot.Tick = aFrame;
+				snapshot.Context.Fill(aFrame);
+				lock.Publish(snapshot);
+			},
+			[&](uint32_t& aFrame)
+			{
+				Snapshot snapshot = lock.Read();
+				if (snapshot.Context.IsTorn()) { counts.Torn++; }
+				if (snapshot.Context.Words[0] != snapshot.Tick) { counts.Mismatched++; }
+				aFrame = snapshot.Tick;
+				return true;
+			}, counts);
+
+			Row("CSeqLock::Read", writer, counts);
+			CHECK(counts.Torn == 0);
+			CHECK(counts.Mismatched == 0);
+			CHECK(counts.Backwards == 0);
+			CHECK(counts.Reads > 0);
+		}
+	}
+
+#if !defined(SLASHGG_TSAN)
+	/* stands in for MumbleLink: the tick first, then the context, a word at a time like a copy into shared memory */
+	struct SharedBlock
+	{
+		volatile unsigned	Tick = 0;
+		Frame				Context{};
+	};
+
+	/* a copy made while a write is in progress that already bumped the tick cannot be told apart with a single counter,
+	 * those are counted, not failed. with the writer nonstop it is preempted mid-write most of the time and the count shows the worst case. */
+	void Versioned(double aSeconds)
+	{
+		for (EWriter writer : { EWriter::None, EWriter::Paced, EWriter::Nonstop })
+		{
+			SharedBlock* block = new SharedBlock();
+			Counts counts;
+			Torture(aSeconds, READERS, writer, [&](uint32_t aFrame)
+			{
+				block->Tick = aFrame;
+				std::atomic_thread_fence(std::memory_order_release);
+				volatile uint32_t* words = block->Context.Words;
+				for (size_t i = 0; i < 64; i++)
+				{
+					words[i] = aFrame;
+				}
+			},
+			[&](uint32_t& aFrame)
+			{
+				Frame copy;
+				unsigned tick = 0;
+				unsigned long long retries = 0;
+				bool success = ReadVersioned(block->Tick, block->Context, copy, tick, 3, retries);
+				counts.Retries += retries;
+				if (!success)
+				{
+					counts.Failed++;
+					return false;
+				}
+				if (copy.IsTorn()) { counts.Torn++; }
+				aFrame = tick;
+				return true;
+			}, counts);
+
+			Row("ReadVersioned", writer, counts);
+			CHECK(counts.Reads > 0);
+			if (writer == EWriter::None)
+			{
+				CHECK(counts.Retries == 0 && counts.Failed == 0 && counts.Torn == 0);
+			}
+			delete block;
+		}
+	}
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	double seconds = 1.0;
+	if (argc == 3 && strcmp(argv[1], "--seconds") == 0)
+	{
+		seconds = atof(argv[2]);
+	}
+
+	printf("%zu readers, %.2f s per row\n", READERS, seconds);
+	printf("%-38s %12s %10s %10s %10s %10s\n", "", "reads", "ns/read", "retries", "failed", "torn");
+	SeqLock(seconds);
+#if !defined(SLASHGG_TSAN)
+	Versioned(seconds);
+#else
+	printf("ReadVersioned left out, it races with the writer by design\n");
+#endif
+
+	return TestResult();
+}
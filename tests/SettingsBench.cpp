@@ -0,0 +1,164 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <istream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+
+#include "Allocations.h"
+#include "Check.h"
+#include "Settings.h"
+
+#include "nlohmann/json.hpp"
+using json = nlohmann::json;
+
+/* Parse time and memory of settings.json as it grows, the baseline json::parse() into a DOM that stayed resident for the session
+ * against ReadSettings() streaming into AddonConfig. The files hold the full palette plus N profiles, which the current schema does not know
+ * and skips, standing in for the settings to come. Files are parsed from memory, the disk is not part of it.
+ *
+ * usage: settingsbench [--max-profiles N] */
+
+namespace
+{
+	/* reads a string in place, an istringstream would copy the file into the measurement */
+	struct MemoryStream : std::streambuf, std::istream
+	{
+		MemoryStream(const std::string& aText)
+			: std::istream(this)
+		{
+			char* begin = const_cast<char*>(aText.data());
+			setg(begin, begin, begin + aText.size());
+		}
+	};
+
+	std::string Generate(unsigned aProfiles)
+	{
+		AddonConfig config;
+		config.PhraseCount = static_cast<int>(MAX_PHRASES);
+		for (size_t i = 0; i < MAX_PHRASES; i++)
+		{
+			snprintf(config.Phrases[i], PHRASE_LENGTH, "Phrase %zu, gg wp \xC3\xA4\xE2\x82\xAC everyone, see you next run", i);
+		}
+
+		std::ostringstream stream;
+		WriteSettings(stream, config);
+		std::string text = stream.str();
+
+		/* the profiles go in front of the closing brace */
+		std::string profiles = ",\n\t\"Profiles\": [";
+		for (unsigned p = 0; p < aProfiles; p++)
+		{
+			profiles += p > 0 ? ",\n\t\t{ " : "\n\t\t{ ";
+			profiles += "\"Name\": \"Profile " + std::to_string(p) + "\", \"IsVisible\": true, \"CoalesceWindowMs\": " + std::to_string(p % 5000) + ", \"HoverTint\": \"#C0FFC0FF\", \"Phrases\": [";
+			for (size_t i = 0; i < MAX_PHRASES; i++)
+			{
+				profiles += (i > 0 ? ", " : "") + json(config.Phrases[i]).dump();
+			}
+			profiles += "] }";
+		}
+		profiles += "\n\t]";
+
+		text.insert(text.rfind("\n}"), profiles);
+		return text;
+	}
+
+	struct Measured
+	{
+		double				Ms;
+		unsigned long long	Allocations;
+		long long			PeakBytes;		/* above what was allocated before the parse */
+		long long			RetainedBytes;	/* still allocated after it, for the session */
+	};
+
+	template<typename F>
+	Measured Measure(unsigned aIterations, F aParse)
+	{
+		Measured measured{};
+		double total = 0;
+		for (unsigned i = 0; i < aIterations; i++)
+		{
+			long long before = AllocatedBytes();
+			ResetPeakBytes();
+			unsigned long long allocations = Allocations();
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			aParse([&]
+			{
+				/* called while the result is still alive */
+				measured.RetainedBytes = AllocatedBytes() - before;
+			});
+
+			total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			measured.Allocations = Allocations() - allocations;
+			measured.PeakBytes = PeakBytes() - before;
+		}
+		measured.Ms = total / aIterations;
+		return measured;
+	}
+
+	void Row(const char* aName, size_t aBytes, const Measured& aMeasured)
+	{
+		printf("%-10s %10zu %10.3f %12llu %12lld %12lld\n", aName, aBytes, aMeasured.Ms, aMeasured.Allocations, aMeasured.PeakBytes, aMeasured.RetainedBytes);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned maxProfiles = 16384;
+	if (argc == 3 && strcmp(argv[1], "--max-profiles") == 0)
+	{
+		maxProfiles = static_cast<unsigned>(atoi(argv[2]));
+	}
+
+	printf("%-10s %10s %10s %12s %12s %12s\n", "", "file_bytes", "ms", "allocations", "peak_bytes", "retained");
+
+	for (unsigned profiles = 0; profiles <= maxProfiles; profiles = profiles ? profiles * 8 : 4)
+	{
+		std::string text = Generate(profiles);
+		unsigned iterations = profiles < 512 ? 50 : 3;
+
+		AddonConfig baselineConfig;
+		Measured baseline = Measure(iterations, [&](auto aAlive)
+		{
+			MemoryStream stream(text);
+			json settings = json::parse(stream);
+			if (!settings["IsVisible"].is_null()) { settings["IsVisible"].get_to(baselineConfig.IsVisible); }
+			if (!settings["RestoreClipboard"].is_null()) { settings["RestoreClipboard"].get_to(baselineConfig.RestoreClipboard); }
+			if (!settings["CoalesceWindowMs"].is_null()) { settings["CoalesceWindowMs"].get_to(baselineConfig.CoalesceWindowMs); }
+			if (!settings["InjectionMode"].is_null()) { baselineConfig.InjectionMode = static_cast<EInjectionMode>(settings["InjectionMode"].get<int>()); }
+			aAlive();
+		});
+
+		AddonConfig config;
+		bool success = true;
+		Measured streamed = Measure(iterations, [&](auto aAlive)
+		{
+			MemoryStream stream(text);
+			std::string error;
+			success &= ReadSettings(stream, config, error);
+			aAlive();
+		});
+
+		printf("%u profiles\n", profiles);
+		Row("  DOM", text.size(), baseline);
+		Row("  stream", text.size(), streamed);
+
+		CHECK(success);
+		CHECK(config.PhraseCount == static_cast<int>(MAX_PHRASES));
+		CHECK(strncmp(config.Phrases[7], "Phrase 7", 8) == 0);
+		CHECK(baselineConfig.CoalesceWindowMs == config.CoalesceWindowMs);
+
+		/* nothing stays behind, and the stream does not grow with what it skips */
+		CHECK(streamed.RetainedBytes <= 0);
+		CHECK(streamed.PeakBytes < 64 * 1024);
+		if (profiles >= 32)
+		{
+			CHECK(streamed.PeakBytes * 10 < baseline.PeakBytes);
+			CHECK(streamed.Ms < baseline.Ms);
+		}
+	}
+
+	return TestResult();
+}
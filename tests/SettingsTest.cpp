@@ -0,0 +1,133 @@
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#include "Check.h"
+#include "Settings.h"
+
+/* ReadSettings() and WriteSettings(): round trips, migrating older files, and what is skipped or rejected while reading. */
+
+namespace
+{
+	bool Read(const std::string& aJson, AddonConfig& aConfig)
+	{
+		std::istringstream stream(aJson);
+		std::string error;
+		return ReadSettings(stream, aConfig, error);
+	}
+
+	void RoundTrip()
+	{
+		AddonConfig config;
+		config.IsVisible = false;
+		config.InjectionMode = EInjectionMode::WindowMessages;
+		config.CoalesceWindowMs = MAX_COALESCE_WINDOW_MS;
+		config.PhraseCount = 2;
+		strcpy(config.Phrases[1], "gg \xC3\xA4\xE2\x82\xAC \"quoted\"");
+		config.HoverTint = 0x12345678;
+
+		std::ostringstream stream;
+		CHECK(WriteSettings(stream, config));
+
+		AddonConfig read;
+		CHECK(Read(stream.str(), read));
+		CHECK(!read.IsVisible);
+		CHECK(read.InjectionMode == EInjectionMode::WindowMessages);
+		CHECK(read.CoalesceWindowMs == MAX_COALESCE_WINDOW_MS);
+		CHECK(read.PhraseCount == 2);
+		CHECK(strcmp(read.Phrases[0], "/gg") == 0);
+		CHECK(strcmp(read.Phrases[1], config.Phrases[1]) == 0);
+		CHECK(read.HoverTint == 0x12345678);
+		CHECK(stream.str().find("\"Version\": 1") != std::string::npos);
+	}
+
+	/* out of range values keep what the config had, in range neighbours are still read */
+	void Ranges()
+	{
+		AddonConfig config;
+		CHECK(Read("{ \"Version\": 1, \"CoalesceWindowMs\": -1, \"InjectionMode\": 3, \"IsVisible\": false }", config));
+		CHECK(config.CoalesceWindowMs == 50);
+		CHECK(config.InjectionMode == EInjectionMode::Clipboard);
+		CHECK(!config.IsVisible);
+
+		CHECK(Read("{ \"Version\": 1, \"CoalesceWindowMs\": 5001, \"InjectionMode\": -1 }", config));
+		CHECK(config.CoalesceWindowMs == 50);
+		CHECK(config.InjectionMode == EInjectionMode::Clipboard);
+
+		/* would wrap to 0 and to Unicode as an int */
+		CHECK(Read("{ \"Version\": 1, \"CoalesceWindowMs\": 4294967296, \"InjectionMode\": 4294967297, \"HoverTint\": 1 }", config));
+		CHECK(config.CoalesceWindowMs == 50);
+		CHECK(config.InjectionMode == EInjectionMode::Clipboard);
+
+		CHECK(Read("{ \"Version\": 1, \"CoalesceWindowMs\": 18446744073709551615 }", config));
+		CHECK(config.CoalesceWindowMs == 50);
+
+		CHECK(Read("{ \"Version\": 1, \"CoalesceWindowMs\": 0, \"InjectionMode\": 2 }", config));
+		CHECK(config.CoalesceWindowMs == 0);
+		CHECK(config.InjectionMode == EInjectionMode::WindowMessages);
+	}
+
+	void Skipped()
+	{
+		AddonConfig config;
+		CHECK(Read("{ \"Version\": 1, \"Unknown\": { \"IsVisible\": false, \"List\": [1, 2] }, \"IsVisible\": 1, \"CoalesceWindowMs\": 2.5,"
+			" \"RestoreClipboard\": \"no\", \"PressedTint\": \"#XYZ\", \"HighlightBackground\": \"#0000007F\", \"Phrases\": [] }", config));
+		CHECK(config.IsVisible);
+		CHECK(config.RestoreClipboard);
+		CHECK(config.CoalesceWindowMs == 50);
+		CHECK(config.PressedTint == 0x9A9A9AFF);
+		CHECK(config.HighlightBackground == 0x0000007F);
+		CHECK(config.PhraseCount == 1);
+
+		/* a malformed file leaves everything as it was */
+		CHECK(!Read("{ \"IsVisible\": false, ", config));
+		CHECK(config.IsVisible);
+	}
+
+	/* what the baseline's json DOM wrote with dump(1, '\t'), without a Version */
+	void Baseline()
+	{
+		AddonConfig config;
+		CHECK(Read("{\n\t\"IsVisible\": false,\n\t\"RestoreClipboard\": false\n}\n", config));
+		CHECK(!config.IsVisible);
+		CHECK(!config.RestoreClipboard);
+		CHECK(config.CoalesceWindowMs == 0);
+		CHECK(config.InjectionMode == EInjectionMode::Clipboard);
+		CHECK(config.PhraseCount == 1 && strcmp(config.Phrases[0], "/gg") == 0);
+		CHECK(config.Version == SETTINGS_VERSION);
+
+		/* saved again it is a current file, a window set since is not migrated away */
+		config.CoalesceWindowMs = 40;
+		std::ostringstream stream;
+		CHECK(WriteSettings(stream, config));
+		AddonConfig read;
+		CHECK(Read(stream.str(), read));
+		CHECK(read.CoalesceWindowMs == 40);
+		CHECK(!read.IsVisible);
+	}
+
+	/* a file from a newer SlashGG is read as far as it is known and never written back over */
+	void Newer()
+	{
+		AddonConfig config;
+		CHECK(Read("{ \"Version\": 7, \"IsVisible\": false, \"CoalesceWindowMs\": 250, \"Profiles\": [] }", config));
+		CHECK(config.Version == 7);
+		CHECK(!config.IsVisible);
+		CHECK(config.CoalesceWindowMs == 250);
+
+		std::ostringstream stream;
+		CHECK(!WriteSettings(stream, config));
+		CHECK(stream.str().empty());
+	}
+}
+
+int main()
+{
+	RoundTrip();
+	Ranges();
+	Skipped();
+	Baseline();
+	Newer();
+
+	return TestResult();
+}
@@ -0,0 +1,128 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+
+#include "Cancellation.h"
+#include "Check.h"
+#include "Histogram.h"
+#include "Signal.h"
+
+/* Benchmark of the worker wakeup: CSignal against the Sleep(1) polling loop it replaced.
+ * Reports how often an idle worker wakes up per second and how long a trigger takes until the worker runs.
+ *
+ * usage: signalbench [--idle-ms N] [--triggers N] */
+
+namespace
+{
+	long long NowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/* Both workers record the wakeups they did and the latency of every trigger they picked up. */
+	struct Worker
+	{
+		std::atomic<long long>			Fired{ 0 };		/* time of the pending trigger, 0 if none */
+		std::atomic<unsigned long long>	Handled{ 0 };
+		std::atomic<unsigned long long>	Wakeups{ 0 };
+		CHistogram						Latency;		/* nanoseconds */
+		CCancellation					Cancel;
+
+		void Handle()
+		{
+			long long fired = Fired.exchange(0);
+			if (fired != 0)
+			{
+				Latency.Record(static_cast<unsigned long long>(NowNs() - fired));
+				Handled.fetch_add(1);
+			}
+		}
+	};
+
+	template<typename Notify, typename Loop>
+	void Measure(Worker& aWorker, Notify aNotify, Loop aLoop, int aIdleMs, unsigned aTriggers, double& aIdleWakeups)
+	{
+		std::thread thread(aLoop);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(aIdleMs));
+		aIdleWakeups = aWorker.Wakeups * 1000.0 / aIdleMs;
+
+		std::mt19937 random(1);
+		for (unsigned i = 0; i < aTriggers; i++)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(std::uniform_int_distribution<int>(200, 2000)(random)));
+			aWorker.Fired.store(NowNs());
+			aNotify();
+			while (aWorker.Handled.load() <= i)
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		aWorker.Cancel.Cancel();
+		aNotify();
+		thread.join();
+	}
+
+	void Row(const char* aName, double aIdleWakeups, const CHistogram& aLatency)
+	{
+		printf("%-16s %16.1f %10.1f %10.1f %10.1f\n", aName, aIdleWakeups,
+			aLatency.Percentile(0.50) / 1000.0, aLatency.Percentile(0.95) / 1000.0, aLatency.Percentile(0.99) / 1000.0);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int idleMs = 2000;
+	unsigned triggers = 2000;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "--idle-ms") == 0)			{ idleMs = atoi(argv[i + 1]); }
+		else if (strcmp(argv[i], "--triggers") == 0)	{ triggers = static_cast<unsigned>(atoi(argv[i + 1])); }
+	}
+	if (idleMs <= 0)
+	{
+		idleMs = 1;
+	}
+
+	/* the baseline worker: look for work, sleep a millisecond, repeat */
+	Worker polling;
+	double pollingIdle = 0;
+	Measure(polling, [] {}, [&polling]
+	{
+		while (!polling.Cancel.IsCancelled())
+		{
+			polling.Handle();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			polling.Wakeups++;
+		}
+	}, idleMs, triggers, pollingIdle);
+
+	/* the current worker: sleeps until a trigger notifies it */
+	Worker signalled;
+	CSignal signal;
+	double signalIdle = 0;
+	Measure(signalled, [&signal] { signal.Notify(); }, [&signalled, &signal]
+	{
+		while (signal.Wait(signalled.Cancel))
+		{
+			signalled.Wakeups++;
+			signalled.Handle();
+		}
+	}, idleMs, triggers, signalIdle);
+
+	printf("%u triggers 0.2-2 ms apart, %d ms idle\n", triggers, idleMs);
+	printf("%-16s %16s %10s %10s %10s\n", "worker", "idle_wakeups/s", "p50_us", "p95_us", "p99_us");
+	Row("Sleep(1) polling", pollingIdle, polling.Latency);
+	Row("CSignal", signalIdle, signalled.Latency);
+
+	CHECK(signalIdle == 0.0);
+	CHECK(pollingIdle > 0.0);
+	CHECK(signalled.Latency.Count() == triggers);
+	return TestResult();
+}
@@ -0,0 +1,106 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "Scenario.h"
+
+/* Headless GG simulator: runs scripted GG sequences through CGGPipeline against a simulated game and clipboard.
+ * Exits with 1 if the success rate stays below --min-success, so ctest can run it as a regression check. */
+
+namespace
+{
+	void Usage()
+	{
+		fprintf(stderr,
+			"usage: ggsim [options]\n"
+			"  --count N             bursts of triggers to run (1000)\n"
+			"  --burst N             triggers per burst (1)\n"
+			"  --no-batch            send a burst one trigger per chat session, each after the last one's restore\n"
+			"  --spacing MS          time from one trigger of a burst to the next (0)\n"
+			"  --restore-inline      wait for the chat to close and restore before serving the next trigger\n"
+			"  --interval MS         time from one burst to the next (500)\n"
+			"  --realtime            sleep for real instead of using the virtual clock\n"
+			"  --mode NAME           clipboard, unicode or messages (clipboard)\n"
+			"  --fps N               simulated frame rate (60)\n"
+			"  --focus-delay MIN:MAX frames until the chat shows as open (1:3)\n"
+			"  --contention MS       another process holds the clipboard this long before every burst (0)\n"
+			"  --clipboard-bytes N   size of the user's clipboard content (64)\n"
+			"  --no-restore          do not restore the clipboard\n"
+			"  --seed N              seed of the scripted delays (1)\n"
+			"  --min-success R       fail unless at least this share of triggers is delivered (0)\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	ScenarioOptions options;
+	double minSuccess = 0.0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		bool hasValue = true;
+
+		if (strcmp(arg, "--count") == 0 && value)					{ options.Bursts = static_cast<unsigned>(atoi(value)); }
+		else if (strcmp(arg, "--burst") == 0 && value)				{ options.BurstSize = static_cast<unsigned>(atoi(value)); }
+		else if (strcmp(arg, "--interval") == 0 && value)			{ options.BurstInterval = static_cast<long long>(atof(value) * 1000.0); }
+		else if (strcmp(arg, "--spacing") == 0 && value)			{ options.BurstSpacing = static_cast<long long>(atof(value) * 1000.0); }
+		else if (strcmp(arg, "--fps") == 0 && value)				{ options.FramesPerSecond = atof(value); }
+		else if (strcmp(arg, "--contention") == 0 && value)			{ options.Contention = static_cast<long long>(atof(value) * 1000.0); }
+		else if (strcmp(arg, "--clipboard-bytes") == 0 && value)	{ options.ClipboardBytes = static_cast<size_t>(atoll(value)); }
+		else if (strcmp(arg, "--seed") == 0 && value)				{ options.Seed = static_cast<uint32_t>(atoi(value)); }
+		else if (strcmp(arg, "--min-success") == 0 && value)		{ minSuccess = atof(value); }
+		else if (strcmp(arg, "--focus-delay") == 0 && value)
+		{
+			unsigned low = 0, high = 0;
+			if (sscanf(value, "%u:%u", &low, &high) == 2 && low <= high)
+			{
+				options.FocusDelayMin = low;
+				options.FocusDelayMax = high;
+			}
+			else if (sscanf(value, "%u", &low) == 1)
+			{
+				options.FocusDelayMin = options.FocusDelayMax = low;
+			}
+		}
+		else if (strcmp(arg, "--mode") == 0 && value)
+		{
+			if (strcmp(value, "clipboard") == 0)		{ options.Mode = EInjectionMode::Clipboard; }
+			else if (strcmp(value, "unicode") == 0)		{ options.Mode = EInjectionMode::Unicode; }
+			else if (strcmp(value, "messages") == 0)	{ options.Mode = EInjectionMode::WindowMessages; }
+			else { Usage(); return 2; }
+		}
+		else
+		{
+			hasValue = false;
+			if (strcmp(arg, "--realtime") == 0)			{ options.IsRealtime = true; }
+			else if (strcmp(arg, "--no-restore") == 0)	{ options.RestoreClipboard = false; }
+			else if (strcmp(arg, "--no-batch") == 0)	{ options.IsBatched = false; }
+			else if (strcmp(arg, "--restore-inline") == 0)	{ options.IsRestoreInline = true; }
+			else { Usage(); return 2; }
+		}
+
+		if (hasValue)
+		{
+			i++;
+		}
+	}
+
+	if (options.Bursts == 0 || options.BurstSize == 0 || options.FramesPerSecond <= 0)
+	{
+		Usage();
+		return 2;
+	}
+
+	ScenarioResult result = RunScenario(options);
+	PrintResult(stdout, options, result);
+
+	if (result.SuccessRate() < minSuccess || result.Wrong > 0)
+	{
+		fprintf(stderr, "FAILED: success %.4f below %.4f or %llu wrong messages\n", result.SuccessRate(), minSuccess, result.Wrong);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,188 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "Check.h"
+#include "Snapshot.h"
+
+/* CSnapshot: when replaced versions are freed, and readers hammering it while a writer replaces it as fast as it can.
+ * Every version carries a checksum that its destructor wipes, a reader seeing a freed or half written version fails the checks,
+ * built with SLASHGG_SANITIZER=thread or address the sanitizer reports it as well.
+ *
+ * usage: snapshot_test [--seconds S] */
+
+namespace
+{
+	std::atomic<long> Live{ 0 };
+
+	struct Version
+	{
+		uint64_t	Value = 0;
+		uint64_t	Check = Sum(0);
+
+		Version() { Live++; }
+		Version(const Version& aOther) : Value(aOther.Value), Check(aOther.Check) { Live++; }
+		~Version() { Check = 0; Live--; }
+
+		static uint64_t Sum(uint64_t aValue)
+		{
+			return aValue * 0x9E3779B97F4A7C15ull + 1;
+		}
+
+		bool IsIntact() const
+		{
+			return Check == Sum(Value);
+		}
+	};
+
+	void Next(Version& aVersion)
+	{
+		aVersion.Value++;
+		aVersion.Check = Version::Sum(aVersion.Value);
+	}
+
+	/* a version is kept exactly as long as an online reader may hold it */
+	void Reclamation()
+	{
+		CSnapshot<Version, 2> snapshot;
+
+		/* nobody reading, replaced versions go right away */
+		snapshot.Update(Next);
+		snapshot.Update(Next);
+		CHECK(snapshot.Pending() == 0);
+		CHECK(snapshot.Revision() == 2);
+
+		snapshot.Online(0);
+		const Version* held = snapshot.Get();
+		snapshot.Update(Next);
+		snapshot.Update(Next);
+		snapshot.Update(Next);
+		CHECK(snapshot.Pending() == 3);
+		CHECK(held->IsIntact() && held->Value == 2);
+		CHECK(snapshot.Get()->Value == 5);
+
+		/* an offline reader does not hold anything back */
+		snapshot.Offline(1);
+		snapshot.Update(Next);
+		CHECK(snapshot.Pending() == 4);
+
+		/* after its quiescent point the reader only holds what it gets from then on */
+		snapshot.Quiescent(0);
+		held = snapshot.Get();
+		snapshot.Update(Next);
+		CHECK(snapshot.Pending() == 1);
+		CHECK(held->IsIntact() && held->Value == 6);
+
+		snapshot.Offline(0);
+		snapshot.Update(Next);
+		CHECK(snapshot.Pending() == 0);
+		CHECK(Live == 1);
+	}
+
+	/* readers keep a few versions between quiescent points and go offline now and then, one writer replaces the version in a loop */
+	void Stress(double aSeconds)
+	{
+		const size_t READERS = 3;
+		const size_t HELD = 8;
+
+		CSnapshot<Version, READERS> snapshot;
+		std::atomic<bool> stop{ false };
+		std::atomic<unsigned long long> reads{ 0 };
+		std::atomic<unsigned long long> torn{ 0 };
+		std::atomic<unsigned long long> backwards{ 0 };
+
+		std::vector<std::thread> readers;
+		for (size_t r = 0; r < READERS; r++)
+		{
+			readers.emplace_back([&, r]
+			{
+				const Version* held[HELD]{};
+				uint64_t last = 0;
+				unsigned long long count = 0;
+
+				snapshot.Online(r);
+				while (!stop.load(std::memory_order_relaxed))
+				{
+					const Version* version = snapshot.Get();
+					held[count % HELD] = version;
+					count++;
+
+					if (version->Value < last) { backwards++; }
+					last = version->Value;
+
+					for (const Version* h : held)
+					{
+						if (h && !h->IsIntact()) { torn++; }
+					}
+
+					if (count % 64 == 0)
+					{
+						memset(held, 0, sizeof(held));
+						snapshot.Quiescent(r);
+					}
+					if (count % 4096 == 0)
+					{
+						memset(held, 0, sizeof(held));
+						snapshot.Offline(r);
+						snapshot.Online(r);
+					}
+				}
+				snapshot.Offline(r);
+				reads += count;
+			});
+		}
+
+		unsigned long long updates = 0;
+		size_t maxPending = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(aSeconds));
+		while (std::chrono::steady_clock::now() < end)
+		{
+			snapshot.Update(Next);
+			updates++;
+
+			size_t pending = snapshot.Pending();
+			if (pending > maxPending) { maxPending = pending; }
+		}
+		stop = true;
+		for (std::thread& reader : readers)
+		{
+			reader.join();
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		printf("%zu readers, %.2f s: %.0f updates/s, %.0f reads/s, at most %zu versions waiting to be freed\n",
+			READERS, seconds, updates / seconds, reads / seconds, maxPending);
+
+		CHECK(torn == 0);
+		CHECK(backwards == 0);
+		CHECK(snapshot.Get()->Value == updates);
+
+		/* freed while the readers ran, not only at the end */
+		CHECK(maxPending < updates);
+
+		/* every reader is offline, the next update frees everything that is left */
+		snapshot.Update(Next);
+		CHECK(snapshot.Pending() == 0);
+		CHECK(Live == 1);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	double seconds = 2.0;
+	if (argc == 3 && strcmp(argv[1], "--seconds") == 0)
+	{
+		seconds = atof(argv[2]);
+	}
+
+	Reclamation();
+	Stress(seconds);
+
+	return TestResult();
+}
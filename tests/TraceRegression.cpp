@@ -0,0 +1,234 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "Check.h"
+#include "Fakes.h"
+#include "MumbleTrace.h"
+#include "Scenario.h"
+#include "TraceReplay.h"
+
+/* Timing regression test: replays a MumbleLink trace through CGGPipeline and fires a GG shortly before every chat opening in it.
+ * The trace decides when the chat shows as open and closed, so the numbers are the pipeline's own cost on top of real frame timings:
+ * - every opening within FOCUS_WAIT_FRAMES and FOCUS_WAIT_TIMEOUT is caught, every one outside fails instead of hanging
+ * - focus is seen on the frame it was recorded, the wait adds nothing
+ * - the clipboard is restored no later than the first frame that shows the chat closed, or the restore deadline
+ *
+ * usage: tracereplay [trace] [--lead FRAMES] [--speed X]
+ * Without a trace a synthetic one is written next to the executable, one file per lead and speed so parallel runs do not map a file another one rewrites. Record a real one with "Record MumbleLink trace" in the options. */
+
+namespace
+{
+	class CRecordingInput : public IInput
+	{
+	public:
+		CRecordingInput(IClock& aClock)
+			: Clock(aClock)
+		{
+		}
+
+		void Send(EKeySequence aSequence, unsigned) override
+		{
+			LastSent[static_cast<int>(aSequence)] = Clock.Now();
+		}
+
+		const wchar_t* Text(unsigned) override
+		{
+			return L"/gg";
+		}
+
+		long long LastSent[KEY_SEQUENCE_COUNT]{};
+
+	private:
+		IClock& Clock;
+	};
+
+	/* Frame times between 7 and 25 ms with the odd loading hitch, the chat opens every 1-4 s for 0.2-3 s. */
+	bool WriteSyntheticTrace(const std::filesystem::path& aPath, uint32_t aSeed)
+	{
+		CTraceRecorder recorder;
+		if (!recorder.Start(aPath))
+		{
+			return false;
+		}
+
+		std::mt19937 random(aSeed);
+		long long time = 0;
+		long long nextOpen = 1000000;
+		long long nextClose = 0;
+		bool isOpen = false;
+
+		for (uint32_t tick = 1; tick <= 60000; tick++)
+		{
+			time += std::uniform_int_distribution<long long>(7000, 25000)(random);
+			if (std::uniform_int_distribution<int>(0, 999)(random) == 0)
+			{
+				time += 300000;
+			}
+
+			if (!isOpen && time >= nextOpen)
+			{
+				isOpen = true;
+				nextClose = time + std::uniform_int_distribution<long long>(200000, 3000000)(random);
+			}
+			else if (isOpen && time >= nextClose)
+			{
+				isOpen = false;
+				nextOpen = time + std::uniform_int_distribution<long long>(1000000, 4000000)(random);
+			}
+
+			uint8_t flags = ETraceFlags_IsGameFocused | ETraceFlags_IsInstance | (isOpen ? ETraceFlags_IsTextboxFocused : 0);
+			recorder.Record(TraceRecord{ tick, time, 1206, 4, flags });
+		}
+
+		recorder.Stop();
+		return true;
+	}
+
+	bool IsFocused(const TraceRecord& aRecord)
+	{
+		return (aRecord.Flags & ETraceFlags_IsTextboxFocused) != 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::filesystem::path path;
+	size_t lead = 2;
+	double speed = 1.0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--lead") == 0 && i + 1 < argc)			{ lead = static_cast<size_t>(atoi(argv[++i])); }
+		else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc)	{ speed = atof(argv[++i]); }
+		else														{ path = argv[i]; }
+	}
+
+	if (path.empty())
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "synthetic-lead%zu-speed%g.trace", lead, speed);
+		path = std::filesystem::path(argv[0]).parent_path() / name;
+		if (!WriteSyntheticTrace(path, 7))
+		{
+			fprintf(stderr, "could not write %s\n", path.string().c_str());
+			return 1;
+		}
+	}
+
+	CVirtualClock clock;
+	clock.Time = 1000000;
+	CTraceReplay replay(clock, speed);
+	if (!replay.Open(path))
+	{
+		fprintf(stderr, "could not open %s\n", path.string().c_str());
+		return 1;
+	}
+
+	CFakeClipboard clipboard(clock);
+	clipboard.SetText(L"what the user copied");
+	CRecordingInput input(clock);
+	CGGPipeline pipeline(input, clipboard, replay, clock);
+	AddonConfig config;
+
+	long long focusWait = std::chrono::duration_cast<std::chrono::microseconds>(FOCUS_WAIT_TIMEOUT).count();
+	long long restoreWait = std::chrono::duration_cast<std::chrono::microseconds>(RESTORE_WAIT_TIMEOUT).count();
+
+	CHistogram triggerToFocus, detectionLag, session, restoreAfterClose;
+	unsigned long long openings = 0, reachable = 0, caught = 0, missedReachable = 0, lateRestores = 0, deadlineRestores = 0;
+
+	for (size_t e = lead + 1; e < replay.Count(); e++)
+	{
+		const TraceRecord& edge = replay.At(e);
+		if (!IsFocused(edge) || IsFocused(replay.At(e - 1)) || !(edge.Flags & ETraceFlags_IsInstance))
+		{
+			continue;
+		}
+		openings++;
+
+		/* the GG is fired lead frames before the chat showed open, in a frame that showed it closed */
+		size_t first = e - lead;
+		long long trigger = replay.TimeOf(first);
+		if (trigger < clock.Now() || IsFocused(replay.At(first)))
+		{
+			continue;
+		}
+		clock.SleepUntil(trigger);
+
+		bool isReachable = lead <= FOCUS_WAIT_FRAMES && replay.TimeOf(e) - trigger <= focusWait;
+		reachable += isReachable ? 1 : 0;
+
+		Trigger gg{ ETriggerSource::Keybind, 0, trigger };
+		unsigned sent = pipeline.Run(&gg, 1, config);
+		long long submitted = clock.Now();
+
+		if (sent == 1)
+		{
+			caught++;
+			long long focusSeen = input.LastSent[static_cast<int>(EKeySequence::Paste)];
+			triggerToFocus.Record(static_cast<unsigned long long>(focusSeen - trigger));
+			detectionLag.Record(static_cast<unsigned long long>(focusSeen - replay.TimeOf(e)));
+			session.Record(static_cast<unsigned long long>(submitted - trigger));
+			CHECK(focusSeen == replay.TimeOf(e));
+		}
+		else if (isReachable)
+		{
+			missedReachable++;
+		}
+
+		/* when the restore is due: the first frame at or after the submit that shows the chat closed, or the deadline */
+		size_t closed = e;
+		while (closed < replay.Count() && (IsFocused(replay.At(closed)) || replay.TimeOf(closed) < submitted))
+		{
+			closed++;
+		}
+		bool closesInTime = closed < replay.Count() && replay.TimeOf(closed) < submitted + restoreWait;
+		long long due = closesInTime ? replay.TimeOf(closed) : submitted + restoreWait;
+
+		unsigned long long restores = clipboard.Restores;
+		pipeline.FinishRestore();
+		while (pipeline.IsRestorePending())
+		{
+			replay.WaitNextFrame(pipeline.RestoreDeadline());
+			pipeline.FinishRestore();
+		}
+
+		if (clipboard.Restores > restores)
+		{
+			if (clock.Now() > due)
+			{
+				lateRestores++;
+			}
+			else if (closesInTime)
+			{
+				restoreAfterClose.Record(static_cast<unsigned long long>(clock.Now() - due));
+			}
+			else
+			{
+				deadlineRestores++;
+			}
+		}
+	}
+
+	printf("trace %s: %zu frames, %llu chat openings, GG fired %llu frames ahead of each\n", path.string().c_str(), replay.Count(), openings, static_cast<unsigned long long>(lead));
+	printf("reachable %llu, caught %llu, reachable but missed %llu, late restores %llu, restored at the deadline %llu\n", reachable, caught, missedReachable, lateRestores, deadlineRestores);
+	printf("%-24s %8s %10s %10s %10s\n", "", "samples", "p50_ms", "p95_ms", "p99_ms");
+	auto row = [](const char* aName, const CHistogram& aHistogram)
+	{
+		Percentiles value = Percentiles::Of(aHistogram);
+		printf("%-24s %8llu %10.2f %10.2f %10.2f\n", aName, value.Count, value.P50 / 1000.0, value.P95 / 1000.0, value.P99 / 1000.0);
+	};
+	row("Trigger to focus seen", triggerToFocus);
+	row("Focus seen after frame", detectionLag);
+	row("Trigger to submit", session);
+	row("Restore after close", restoreAfterClose);
+
+	CHECK(openings > 0);
+	CHECK(missedReachable == 0);
+	CHECK(caught == reachable);
+	CHECK(lateRestores == 0);
+	CHECK(clipboard.Text() == L"what the user copied");
+	return TestResult();
+}
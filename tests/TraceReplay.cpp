@@ -0,0 +1,178 @@
+#include "TraceReplay.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CTraceReplay::CTraceReplay(IClock& aClock, double aSpeed)
+	: Clock(aClock), Speed(aSpeed > 0 ? aSpeed : 1.0)
+{
+}
+
+CTraceReplay::~CTraceReplay()
+{
+	Close();
+}
+
+bool CTraceReplay::Open(const std::filesystem::path& aPath)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileW(aPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	FileHandle = file;
+
+	LARGE_INTEGER size{};
+	GetFileSizeEx(file, &size);
+	ViewSize = static_cast<size_t>(size.QuadPart);
+
+	if (ViewSize > 0)
+	{
+		MappingHandle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (MappingHandle)
+		{
+			View = MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0);
+		}
+	}
+#else
+	int fd = open(aPath.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat st {};
+	fstat(fd, &st);
+	ViewSize = static_cast<size_t>(st.st_size);
+
+	if (ViewSize > 0)
+	{
+		void* view = mmap(nullptr, ViewSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		View = view == MAP_FAILED ? nullptr : view;
+	}
+	::close(fd);
+#endif
+
+	const TraceHeader* header = static_cast<const TraceHeader*>(View);
+	if (!View || ViewSize < sizeof(TraceHeader) || memcmp(header->Magic, "SGGT", 4) != 0 || header->Version != TRACE_VERSION)
+	{
+		Close();
+		return false;
+	}
+
+	Records = reinterpret_cast<const TraceRecord*>(static_cast<const char*>(View) + sizeof(TraceHeader));
+	RecordCount = (ViewSize - sizeof(TraceHeader)) / sizeof(TraceRecord);
+
+	Rewind();
+	return RecordCount > 0;
+}
+
+void CTraceReplay::Close()
+{
+#ifdef _WIN32
+	if (View) { UnmapViewOfFile(View); }
+	if (MappingHandle) { CloseHandle(MappingHandle); }
+	if (FileHandle) { CloseHandle(FileHandle); }
+	MappingHandle = nullptr;
+	FileHandle = nullptr;
+#else
+	if (View) { munmap(const_cast<void*>(View), ViewSize); }
+#endif
+
+	View = nullptr;
+	ViewSize = 0;
+	Records = nullptr;
+	RecordCount = 0;
+	Index = 0;
+	Openings = 0;
+}
+
+void CTraceReplay::Rewind()
+{
+	Start = Clock.Now();
+	Index = 0;
+	Openings = 0;
+}
+
+bool CTraceReplay::IsFinished()
+{
+	Current();
+	return Index + 1 >= RecordCount;
+}
+
+const TraceRecord* CTraceReplay::Current()
+{
+	if (RecordCount == 0)
+	{
+		return nullptr;
+	}
+
+	long long now = Clock.Now();
+	while (Index + 1 < RecordCount && TimeOf(Index + 1) <= now)
+	{
+		Index++;
+		if ((Records[Index].Flags & ETraceFlags_IsTextboxFocused) && !(Records[Index - 1].Flags & ETraceFlags_IsTextboxFocused))
+		{
+			Openings++;
+		}
+	}
+
+	return &Records[Index];
+}
+
+bool CTraceReplay::IsTextboxFocused()
+{
+	const TraceRecord* record = Current();
+	return record && (record->Flags & ETraceFlags_IsTextboxFocused);
+}
+
+bool CTraceReplay::IsInInstance()
+{
+	const TraceRecord* record = Current();
+	return record && (record->Flags & ETraceFlags_IsInstance);
+}
+
+unsigned CTraceReplay::TextboxOpenings()
+{
+	Current();
+	return Openings;
+}
+
+bool CTraceReplay::WaitNextFrame(long long aDeadline)
+{
+	Current();
+
+	if (Index + 1 >= RecordCount)
+	{
+		/* the trace is over, nothing will change anymore */
+		Clock.SleepUntil(aDeadline);
+		return false;
+	}
+
+	long long next = TimeOf(Index + 1);
+	if (next > aDeadline)
+	{
+		Clock.SleepUntil(aDeadline);
+		return false;
+	}
+
+	Clock.SleepUntil(next);
+	Current();
+	return true;
+}
+
+long long CTraceReplay::TimeOf(size_t aIndex) const
+{
+	return Start + static_cast<long long>(Records[aIndex].Timestamp / Speed);
+}
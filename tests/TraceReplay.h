@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+#include "MumbleTrace.h"
+#include "Pipeline.h"
+
+/* Memory-maps a recorded trace and plays it back as game state, at original speed or scaled by Speed.
+ * Time comes from the given clock, so with a virtual clock a trace replays instantly and deterministically. */
+class CTraceReplay : public IGameState
+{
+public:
+	CTraceReplay(IClock& aClock, double aSpeed = 1.0);
+	~CTraceReplay();
+
+	bool Open(const std::filesystem::path& aPath);
+	void Close();
+
+	/* Restarts playback from the first record. */
+	void Rewind();
+	bool IsFinished();
+
+	size_t Count() const { return RecordCount; }
+	const TraceRecord& At(size_t aIndex) const { return Records[aIndex]; }
+	const TraceRecord* Current();
+
+	/* when a record becomes current, in clock time */
+	long long TimeOf(size_t aIndex) const;
+
+	bool IsTextboxFocused() override;
+	bool IsInInstance() override;
+	unsigned TextboxOpenings() override;
+	bool WaitNextFrame(long long aDeadline) override;
+
+private:
+	IClock&				Clock;
+	double				Speed;
+	long long			Start = 0;
+	size_t				Index = 0;
+	unsigned			Openings = 0;	/* up to Index */
+
+	const TraceRecord*	Records = nullptr;
+	size_t				RecordCount = 0;
+	const void*			View = nullptr;
+	size_t				ViewSize = 0;
+#ifdef _WIN32
+	void*				FileHandle = nullptr;
+	void*				MappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,138 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "Check.h"
+#include "Settings.h"
+#include "TriggerQueue.h"
+
+/* CTriggerQueue: coalescing per phrase, drops on a full queue and many producers against one consumer. */
+
+namespace
+{
+	void Coalescing()
+	{
+		CTriggerQueue<8, 2> queue;
+		queue.CoalesceWindowMs = 60000;
+
+		CHECK(queue.Push(ETriggerSource::Keybind, 0));
+		CHECK(!queue.Push(ETriggerSource::Button, 0));
+		CHECK(queue.Push(ETriggerSource::Keybind, 1));
+		CHECK(!queue.Push(ETriggerSource::Keybind, 2));
+
+		CHECK(queue.Enqueued == 2);
+		CHECK(queue.Coalesced == 1);
+		CHECK(queue.Dropped == 1);
+
+		Trigger trigger;
+		CHECK(queue.Pop(trigger) && trigger.Phrase == 0 && trigger.Source == ETriggerSource::Keybind);
+		CHECK(queue.Pop(trigger) && trigger.Phrase == 1);
+		CHECK(!queue.Pop(trigger));
+	}
+
+	/* the default window only folds a bounce into the press before it, presses a player means each go out */
+	void DefaultWindow()
+	{
+		CTriggerQueue<8> queue;
+		queue.CoalesceWindowMs = AddonConfig{}.CoalesceWindowMs;
+
+		CHECK(queue.Push(ETriggerSource::Keybind));
+		CHECK(!queue.Push(ETriggerSource::Keybind));
+		for (int i = 0; i < 3; i++)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(150));
+			CHECK(queue.Push(ETriggerSource::Keybind));
+		}
+
+		CHECK(queue.Enqueued == 4);
+		CHECK(queue.Coalesced == 1);
+	}
+
+	/* a trigger dropped because the queue was full is not coalesced into, the next one for the phrase is queued */
+	void FullQueue()
+	{
+		CTriggerQueue<2, 3> queue;
+		queue.CoalesceWindowMs = 60000;
+
+		CHECK(queue.Push(ETriggerSource::Keybind, 0));
+		CHECK(queue.Push(ETriggerSource::Keybind, 1));
+		CHECK(!queue.Push(ETriggerSource::Keybind, 2));
+		CHECK(queue.Dropped == 1);
+
+		Trigger trigger;
+		CHECK(queue.Pop(trigger) && trigger.Phrase == 0);
+		CHECK(queue.Push(ETriggerSource::Keybind, 2));
+		CHECK(queue.Coalesced == 0);
+
+		CHECK(queue.Pop(trigger) && trigger.Phrase == 1);
+		CHECK(queue.Pop(trigger) && trigger.Phrase == 2);
+		CHECK(!queue.Pop(trigger));
+	}
+
+	/* every push is either popped once or counted as dropped, and each producer's triggers come out in order */
+	void Producers()
+	{
+		const unsigned PRODUCERS = 4;
+		const unsigned PUSHES = 200000;
+
+		CTriggerQueue<256, PRODUCERS> queue;
+		std::atomic<unsigned> running{ PRODUCERS };
+		std::vector<std::thread> threads;
+
+		for (unsigned p = 0; p < PRODUCERS; p++)
+		{
+			threads.emplace_back([&queue, &running, p]
+			{
+				for (unsigned i = 0; i < PUSHES; i++)
+				{
+					queue.Push(ETriggerSource::Keybind, p);
+				}
+				running.fetch_sub(1);
+			});
+		}
+
+		unsigned long long popped[PRODUCERS]{};
+		long long last[PRODUCERS]{};
+		bool isOrdered = true;
+		Trigger trigger;
+		for (;;)
+		{
+			bool isDone = running.load() == 0;
+			while (queue.Pop(trigger))
+			{
+				popped[trigger.Phrase]++;
+				isOrdered = isOrdered && trigger.Timestamp >= last[trigger.Phrase];
+				last[trigger.Phrase] = trigger.Timestamp;
+			}
+			if (isDone)
+			{
+				break;
+			}
+		}
+
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		unsigned long long total = 0;
+		for (unsigned long long count : popped)
+		{
+			total += count;
+		}
+		CHECK(isOrdered);
+		CHECK(total == queue.Enqueued);
+		CHECK(queue.Enqueued + queue.Dropped == PRODUCERS * PUSHES);
+		CHECK(queue.Coalesced == 0);
+	}
+}
+
+int main()
+{
+	Coalescing();
+	DefaultWindow();
+	FullQueue();
+	Producers();
+	return TestResult();
+}
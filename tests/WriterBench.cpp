@@ -0,0 +1,135 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "Check.h"
+#include "DeferredWriter.h"
+#include "Histogram.h"
+#include "Settings.h"
+#include "Snapshot.h"
+
+/* Frame callback time during a burst of settings toggles: the baseline saved settings.json synchronously from the options callback,
+ * now the callback swaps in a new config and schedules CDeferredWriter, which writes once after a quiet period on its own thread.
+ * --disk-delay adds a stall to every write, like a slow disk or a virus scanner opening the file.
+ *
+ * usage: writerbench [--toggles N] [--disk-delay MS] */
+
+namespace
+{
+	std::chrono::milliseconds DiskDelay{ 0 };
+	std::atomic<unsigned long long> Writes{ 0 };
+	std::mutex Mutex;
+
+	/* like SaveSettings() in entry.cpp: a temporary file next to the target, swapped in by a rename */
+	void SaveSettings(const std::filesystem::path& aPath, const AddonConfig& aConfig)
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+
+		std::filesystem::path tmpPath = aPath;
+		tmpPath += ".tmp";
+
+		std::ofstream file(tmpPath);
+		std::this_thread::sleep_for(DiskDelay);
+		WriteSettings(file, aConfig);
+		file.close();
+
+		std::error_code ec;
+		std::filesystem::rename(tmpPath, aPath, ec);
+		Writes++;
+	}
+
+	/* one options frame per toggle at 60 fps, records the time each callback took in microseconds */
+	template<typename Callback>
+	void Burst(unsigned aToggles, CHistogram& aCallback, Callback aToggle)
+	{
+		std::chrono::steady_clock::time_point frame = std::chrono::steady_clock::now();
+		for (unsigned i = 0; i < aToggles; i++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			aToggle();
+			aCallback.Record(static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()));
+
+			frame += std::chrono::microseconds(16667);
+			std::this_thread::sleep_until(frame);
+		}
+	}
+
+	void Row(const char* aName, const CHistogram& aCallback, unsigned long long aWrites)
+	{
+		printf("%-22s %10.1f %10.1f %10.1f %10.1f %8llu\n", aName,
+			aCallback.Percentile(0.50) / 1000.0, aCallback.Percentile(0.95) / 1000.0, aCallback.Percentile(0.99) / 1000.0, aCallback.Percentile(1.0) / 1000.0, aWrites);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned toggles = 60;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "--toggles") == 0)			{ toggles = static_cast<unsigned>(atoi(argv[i + 1])); }
+		else if (strcmp(argv[i], "--disk-delay") == 0)	{ DiskDelay = std::chrono::milliseconds(atoi(argv[i + 1])); }
+	}
+
+	std::filesystem::path dir = std::filesystem::temp_directory_path() / ("slashgg-writerbench-" + std::to_string(std::random_device()()));
+	std::filesystem::create_directories(dir);
+	std::filesystem::path path = dir / "settings.json";
+
+	CSnapshot<AddonConfig> config;
+
+	/* baseline: the callback writes the file itself */
+	CHistogram syncCallback;
+	Writes = 0;
+	Burst(toggles, syncCallback, [&]
+	{
+		config.Update([](AddonConfig& aConfig) { aConfig.IsVisible = !aConfig.IsVisible; });
+		SaveSettings(path, *config.Get());
+	});
+	unsigned long long syncWrites = Writes;
+
+	/* now: the callback only schedules, the writer waits for 500 ms without toggles */
+	CHistogram deferredCallback;
+	Writes = 0;
+	CDeferredWriter writer{ std::chrono::milliseconds(500) };
+	writer.Start([&]
+	{
+		config.Online(0);
+		SaveSettings(path, *config.Get());
+		config.Offline(0);
+	});
+	Burst(toggles, deferredCallback, [&]
+	{
+		config.Update([](AddonConfig& aConfig) { aConfig.IsVisible = !aConfig.IsVisible; });
+		writer.Schedule();
+	});
+	unsigned long long writesDuringBurst = Writes;
+	std::this_thread::sleep_for(std::chrono::milliseconds(700));
+	unsigned long long deferredWrites = Writes;
+	writer.Stop();
+
+	printf("%u toggles, one per frame at 60 fps, %lld ms disk delay per write\n", toggles, static_cast<long long>(DiskDelay.count()));
+	printf("%-22s %10s %10s %10s %10s %8s\n", "options callback", "p50_ms", "p95_ms", "p99_ms", "max_ms", "writes");
+	Row("synchronous write", syncCallback, syncWrites);
+	Row("deferred writer", deferredCallback, deferredWrites);
+
+	/* the file on disk has the state after the last toggle */
+	std::ifstream file(path);
+	AddonConfig stored;
+	stored.IsVisible = !config.Get()->IsVisible;
+	std::string error;
+	CHECK(ReadSettings(file, stored, error));
+	CHECK(stored.IsVisible == config.Get()->IsVisible);
+	CHECK(syncWrites == toggles);
+	CHECK(writesDuringBurst == 0);
+	CHECK(deferredWrites == 1);
+	file.close();
+
+	std::filesystem::remove_all(dir);
+	return TestResult();
+}